@@ -0,0 +1,142 @@
+/***************************************************
+ * agenda.cpp
+ * running rules only where something changed
+ **************************************************/
+
+#include "agenda.h"
+
+solv_agenda::solv_agenda(solv_sudoku* _s, const vector<solv_rule*>& _rules):s(_s),rules(_rules),
+	num_cells(_s->getnum_digits() * _s->getnum_digits()),queues(_rules.size()),heads(_rules.size(), 0),
+	queued(_rules.size(), vector<byte>(num_cells, 0)),calls(0),successes(0),tier(0){
+	// a transversal: cell (i, (i % order) * order + i / order) is the only one
+	// in its row, column and box
+	const sudoku_geometry* geometry = s->get_geometry();
+	unit_cell.resize(geometry->num_units);
+	for(uint i = 0; i < geometry->num_digits; i++){
+		const uint cell = s->get_index(i, (i % geometry->order) * geometry->order + i / geometry->order);
+		for(uint group_nr = 0; group_nr < 3; group_nr++)
+			unit_cell[geometry->unit_of(cell, group_nr)] = cell;
+	}
+	// at first every rule is due everywhere
+	for(uint r = 0; r < rules.size(); r++)
+		if(rules[r]->get_scope() == RULE_ONCE) enqueue(r, 0);
+		else if(rules[r]->get_scope() == RULE_GROUPS)
+			for(uint unit = 0; unit < geometry->num_units; unit++) enqueue(r, unit_cell[unit]);
+		else for(uint cell = 0; cell < num_cells; cell++) enqueue(r, cell);
+}
+
+void solv_agenda::enqueue(const uint r, const uint cell){
+	if(queued[r][cell]) return;
+	queued[r][cell] = 1;
+	queues[r].push_back(cell);
+}
+
+void solv_agenda::touch(const uint cell){
+	const sudoku_geometry* geometry = s->get_geometry();
+	for(uint r = 0; r < rules.size(); r++)
+		if(rules[r]->get_scope() == RULE_CELL) enqueue(r, cell);
+		else if(rules[r]->get_scope() == RULE_UNITS){
+			enqueue(r, cell);
+			for(const uint* p = geometry->peers_begin(cell); p != geometry->peers_end(cell); ++p)
+				enqueue(r, *p);
+		} else if(rules[r]->get_scope() == RULE_GROUPS)
+			for(uint group_nr = 0; group_nr < 3; group_nr++)
+				enqueue(r, unit_cell[geometry->unit_of(cell, group_nr)]);
+}
+
+bool solv_agenda::feed(const bool success){
+	const fp_vector<uint>& changes = s->graph->get_changes();
+	// literals of a cell come in runs [see fp_literal()]
+	uint last = num_cells;
+	for(size_t i = 0; i < changes.size(); i++){
+		const uint cell = changes[i] / (2 * s->getnum_digits());
+		if(cell != last) touch(cell);
+		last = cell;
+	}
+	const bool progress = success || !changes.empty();
+	if(progress){
+		for(uint r = 0; r < rules.size(); r++)
+			if(rules[r]->get_scope() == RULE_ONCE) enqueue(r, 0);
+			else if(rules[r]->get_scope() == RULE_GRID)
+				for(uint cell = 0; cell < num_cells; cell++) enqueue(r, cell);
+	}
+	s->graph->clear_changes();
+	return progress;
+}
+
+// apply the rules until none finds anything, return how often they did
+size_t solv_agenda::run(const uint level_bits){
+	const uint digits = s->getnum_digits();
+	const size_t found = successes;
+	s->graph->watch(true);
+	// the cheapest rule with a dirty cell goes next
+	uint r = 0;
+	while(r < rules.size()){
+		if(heads[r] == queues[r].size()){
+			queues[r].clear();
+			heads[r] = 0;
+			r++;
+			continue;
+		}
+		const uint cell = queues[r][heads[r]++];
+		queued[r][cell] = 0;
+		calls++;
+		const bool success = rules[r]->apply(cell % digits, cell / digits, s, level_bits);
+		if(success) successes++;
+		// [a rule may trigger something and still say it found nothing]
+		if(feed(success)){
+			if(r >= tier) tier = r + 1;
+			r = 0;
+		}
+	}
+	s->graph->watch(false);
+	return successes - found;
+}
+
+
+// the rules solv_ladder knows
+struct solv_rule_name{
+	const char* name;
+	bool (*apply)(const uint x, const uint y, solv_sudoku*, const uint);
+	uint scope;
+};
+static const solv_rule_name known_rules[] = {
+	{"flood", flood, RULE_STATIC},
+	{"eliminate", eliminate, RULE_STATIC},
+	{"locate", locate, RULE_STATIC},
+	{"group_intersect", group_intersect, RULE_STATIC},
+	{"alignment", alignment, RULE_GROUPS},
+	{"bigraph", bigraph, RULE_GRID},
+	{"ebigraph", ebigraph, RULE_GRID},
+	{"tca", tca, RULE_GRID},
+	{"bigraph_all", bigraph_all, RULE_ONCE},
+	{"ebigraph_all", ebigraph_all, RULE_ONCE},
+	{"tca_all", tca_all, RULE_ONCE},
+	{"tca_parallel", tca_parallel, RULE_ONCE}
+};
+
+solv_ladder::solv_ladder(const char* spec){
+	const string list(spec);
+	size_t begin = 0;
+	while(begin <= list.size()){
+		size_t end = list.find(',', begin);
+		if(end == string::npos) end = list.size();
+		const string name = list.substr(begin, end - begin);
+		const size_t num_known = sizeof(known_rules) / sizeof(known_rules[0]);
+		size_t k = 0;
+		while((k < num_known) && (name != known_rules[k].name)) k++;
+		if(k == num_known) diewith("unknown rule \"" << name << "\" in \"" << spec << "\"" << endl);
+		rules.push_back(new solv_rule(known_rules[k].apply, known_rules[k].scope));
+		names.push_back(name);
+		begin = end + 1;
+	}
+}
+
+solv_ladder::~solv_ladder(){
+	for(size_t r = 0; r < rules.size(); r++)
+		delete rules[r];
+}
+
+const char* solv_ladder::tier_name(const uint tier) const{
+	return tier ? names[tier - 1].c_str() : "none";
+}
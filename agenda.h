@@ -0,0 +1,89 @@
+/***************************************************
+ * agenda.h
+ * running rules only where something changed
+ **************************************************
+ *
+ * Looping over a rule until it finds nothing [see solv.cpp] tries every
+ * cell again after each success, though a rule can only find something
+ * new where its inputs changed. The agenda keeps a queue of dirty cells
+ * per rule instead: the graph reports the theses it fires or removes
+ * [see fp_graph::watch()], which is all set_trigger() and remove_thesis()
+ * ever do to a cell, and a changed cell is dirty again for every rule
+ * looking at it [RULE_CELL], and together with its peers for every rule
+ * looking at its units [RULE_UNITS]. Rules looking at the whole graph
+ * [RULE_GRID] get all cells again after any change or success, those
+ * covering the grid in one go [RULE_ONCE] get [0,0].
+ *
+ * A rule applied at a cell adds all it finds there [the triggers do the
+ * rest], so a success alone does not make its cell dirty again. Rules that
+ * only add triggers [RULE_STATIC] never need to look again: the triggers
+ * fire on whatever changes later. Rules treating each unit of the cell on
+ * its own [RULE_GROUPS] run once per dirty unit, at the cell a transversal
+ * of the grid has in it.
+ *
+ * The rules form a ladder, cheapest first: the next rule to run is always
+ * the cheapest one with a dirty cell, so an expensive rule only gets to
+ * work when all cheaper ones are stuck, and after it found something the
+ * cheap ones clean up first. The tier of a run is the most expensive rule
+ * that got anywhere. When no queue holds a cell, none of the rules can
+ * find anything anywhere.
+ */
+
+#ifndef agenda_h
+#define agenda_h
+
+#include "solv_rules.h"
+
+// the rules solv uses unless told otherwise [see solv_ladder]
+// [the whole grid variants find the same as bigraph, ebigraph and tca, in
+// one call instead of one per cell and step]
+#define DEFAULT_LADDER "flood,eliminate,locate,group_intersect,alignment,bigraph_all,ebigraph_all,tca_all"
+
+class solv_agenda{
+private:
+	solv_sudoku* s;
+	vector<solv_rule*> rules;
+	uint num_cells;
+	vector<uint> unit_cell;	// per unit: the cell of the transversal in it
+	// per rule: the dirty cells [first ones from heads[r] on] and flags
+	vector<vector<uint> > queues;
+	vector<size_t> heads;
+	vector<vector<byte> > queued;
+	size_t calls;			// rule applications
+	size_t successes;		// ... that found something
+	uint tier;				// 1 + the most expensive rule that did, 0 if none
+
+	void enqueue(const uint r, const uint cell);
+	// make everything depending on the cell dirty
+	void touch(const uint cell);
+	// take the changes of the graph [and whether a rule found something],
+	// return whether there was any progress
+	bool feed(const bool success);
+public:
+	solv_agenda(solv_sudoku* _s, const vector<solv_rule*>& _rules);
+	// apply the rules until none finds anything, return how often they did
+	size_t run(const uint level_bits);
+	size_t get_calls() const { return calls; }
+	size_t get_successes() const { return successes; }
+	uint get_tier() const { return tier; }
+};
+
+// rules by name, cheapest first, as given on the command line: names
+// separated by commas, the known ones are flood, eliminate, locate,
+// group_intersect, alignment, bigraph, ebigraph, tca and the whole grid
+// variants bigraph_all, ebigraph_all, tca_all and tca_parallel
+class solv_ladder{
+private:
+	vector<solv_rule*> rules;
+	vector<string> names;
+public:
+	// dies on unknown names
+	solv_ladder(const char* spec = DEFAULT_LADDER);
+	~solv_ladder();
+	const vector<solv_rule*>& get_rules() const { return rules; }
+	size_t size() const { return rules.size(); }
+	// name of a tier of solv_agenda [1 to size(), 0 is "none"]
+	const char* tier_name(const uint tier) const;
+};
+
+#endif
@@ -3,6 +3,9 @@
  *********************************************
 */
 
+#include <list>
+#include <unordered_set>
+
 #include "align.h"
 
 // Apply align to a bipartite graph starting at vertex "node".
@@ -19,11 +22,11 @@
 // "digit 1". If any digit other than "digits" is put into any of the "cells",
 // then we cannot fit "digits" into the cells anymore.
 
-bool digit_align(const solv_set* group, const uint digit, const uint level_bits){
-  if(!digit || !group) return false;
-  if(group->empty()) return false;
+bool digit_align(const group_view<solv_cell>& group, const uint digit, const uint level_bits){
+  if(!digit) return false;
+  if(group.empty()) return false;
 
-  const uint num_digits = (*(group->begin()))->getnum_digits();
+  const uint num_digits = group.front()->getnum_digits();
   if(!num_digits) return false;
 
   unordered_set<uint> digits;
@@ -31,7 +34,7 @@ bool digit_align(const solv_set* group, const uint digit, const uint level_bits)
 
   // compute the set of cells containing "digit"
   dbgout << "cells with " << digit << ": ";
-  for(solv_set::const_iterator cell = group->begin(); cell != group->end(); ++cell){
+  for(group_view<solv_cell>::iterator cell = group.begin(); cell != group.end(); ++cell){
     if((**cell)[digit]) {
       cells.insert(*cell);
       dbgout << **cell << " ";
@@ -41,13 +44,14 @@ bool digit_align(const solv_set* group, const uint digit, const uint level_bits)
 
   // compile a list of digits that do not occur outside of "cells"
   for(uint i = num_digits; i != 0; --i) digits.insert(i);
-  for(solv_set::const_iterator cell = group->begin(); cell != group->end(); ++cell)
-    if(cells.find(*cell) == cells.end())
+  for(group_view<solv_cell>::iterator cell = group.begin(); cell != group.end(); ++cell)
+    if(cells.find(*cell) == cells.end()){
       for(unordered_set<uint>::const_iterator i = digits.begin(); i != digits.end();)
-        if(! (**cell)[*i]){
+        if((**cell)[*i]){
           unordered_set<uint>::const_iterator j = i++;
           digits.erase(j);
         } else ++i;
+    }
 
   dbgout << "found " << digits.size() << " digits and " << cells.size() << " cells" << endl;
 
@@ -84,9 +88,9 @@ bool digit_align(const solv_set* group, const uint digit, const uint level_bits)
 // are as many cells as digits, none of the digits can occur in a cell outside X
 // since otherwise there are not enough cells to fit all digits.
 
-bool cell_align(const solv_set* group, const solv_cell* node, const uint level_bits){
+bool cell_align(const group_view<solv_cell>& group, const solv_cell* node, const uint level_bits){
 
-  if(!node || !group) return false;
+  if(!node) return false;
 
   // if the cell has just one number, the whole thing doesn't make sense
   if(node->get_content()) return false;
@@ -108,7 +112,7 @@ bool cell_align(const solv_set* group, const solv_cell* node, const uint level_b
     dbgout << "):" << endl;
   }
 
-  for(solv_set::const_iterator cell = group->begin(); cell != group->end(); ++cell){
+  for(group_view<solv_cell>::iterator cell = group.begin(); cell != group.end(); ++cell){
     bool candidate = true;
 
     // if the cell contains a digit that is not in digits, then it's not a candidate
@@ -131,7 +135,7 @@ bool cell_align(const solv_set* group, const solv_cell* node, const uint level_b
  
     // for all cells in "group" that are not in "cells", remove all "digits"
     // from them (aka trigger -i for all i in "digits")
-    for(solv_set::const_iterator cell = group->begin(); cell != group->end(); ++cell)
+    for(group_view<solv_cell>::iterator cell = group.begin(); cell != group.end(); ++cell)
       if(cells.find(*cell) == cells.end()){ // got a cell that's not in "cells"
         for(unordered_set<uint>::const_iterator i = digits.begin(); i != digits.end(); ++i)
           if((**cell)[*i]){ // found an i from "digits" in this cell, so trigger -i
@@ -0,0 +1,273 @@
+/***************************************************
+ * batch.cpp
+ * solving whole corpora on threads
+ **************************************************/
+
+#include "batch.h"
+#include "parallel.h"
+#include <chrono>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+
+batch_solver::batch_solver(const char* ladder_spec, const uint _threads):threads(_threads ? _threads : 1),
+	puzzles(0),solved(0),invalid(0),seconds(0){
+	for(uint t = 0; t < threads; t++)
+		ladders.push_back(new solv_ladder(ladder_spec));
+	tiers.assign(ladders[0]->size() + 1, 0);
+}
+
+batch_solver::~batch_solver(){
+	for(uint t = 0; t < threads; t++)
+		delete ladders[t];
+}
+
+void batch_solver::solve_one(const corpus_entry& entry, const solv_ladder& ladder, batch_result& result) const{
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	result.solved = result.invalid = false;
+	result.error.clear();
+	result.tier = 0;
+	try{
+		solv_sudoku s(entry, 0);
+		solv_agenda agenda(&s, ladder.get_rules());
+		agenda.run(LVL_ALL);
+		result.solved = !s.count_empty();
+		result.tier = agenda.get_tier();
+	} catch(const invalid_sudoku& e){
+		result.invalid = true;
+		result.error = e.what();
+	}
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// solve the entries, results[i] is that of entries[i]
+void batch_solver::solve(const vector<corpus_entry>& entries, vector<batch_result>& results){
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	results.resize(entries.size());
+	// the rules report what they find on cout
+	streambuf* const console = cout.rdbuf(NULL);
+	parallel_for(entries.size(), threads, [&](const size_t begin, const size_t end, const uint thread){
+		for(size_t i = begin; i < end; i++)
+			solve_one(entries[i], *ladders[thread], results[i]);
+	}, 1);
+	cout.rdbuf(console);
+	seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	for(size_t i = 0; i < results.size(); i++){
+		puzzles++;
+		if(results[i].invalid) invalid++;
+		else if(results[i].solved){
+			solved++;
+			tiers[results[i].tier]++;
+		}
+	}
+}
+
+// the next BATCH_CHUNK puzzles of a corpus [fewer at its end], return
+// whether there were any
+static bool next_chunk(corpus_reader& reader, vector<corpus_entry>& entries){
+	entries.clear();
+	corpus_entry entry;
+	while((entries.size() < BATCH_CHUNK) && reader.next(entry))
+		entries.push_back(entry);
+	return !entries.empty();
+}
+
+size_t batch_solver::solve(const char* filename, corpus_reader& reader, FILE* out){
+	vector<corpus_entry> entries;
+	vector<batch_result> results;
+	size_t result = 0;
+	while(next_chunk(reader, entries)){
+		solve(entries, results);
+		for(size_t i = 0; i < entries.size(); i++)
+			print_result(out, filename, entries[i].number, results[i]);
+		result += entries.size();
+	}
+	return result;
+}
+
+void batch_solver::print_result(FILE* out, const char* filename, const size_t number, const batch_result& result) const{
+	if(result.invalid){
+		fprintf(stderr, "%s, puzzle %zu: %s\n", filename, number, result.error.c_str());
+		fprintf(out, "%s\t%zu\tinvalid\t-\t%.3f\n", filename, number, result.seconds * 1000);
+	} else fprintf(out, "%s\t%zu\t%s\t%s\t%.3f\n", filename, number, result.solved ? "solved" : "stuck",
+		get_ladder().tier_name(result.tier), result.seconds * 1000);
+}
+
+void batch_solver::print_summary(FILE* out) const{
+	fprintf(out, "%zu puzzles, %zu solved, %zu stuck, %zu invalid in %.2fs on %u threads: %.1f puzzles/s\n", puzzles,
+		solved, puzzles - solved - invalid, invalid, seconds, threads, puzzles / (seconds > 0 ? seconds : 1));
+	for(uint tier = 0; tier < tiers.size(); tier++)
+		if(tiers[tier]) fprintf(out, "  solved at %-16s %zu\n", get_ladder().tier_name(tier), tiers[tier]);
+}
+
+
+/******** shards ********/
+
+// how far a shard got
+struct batch_checkpoint{
+	size_t file;	// corpus file the next puzzle is in [the number of files when done]
+	size_t offset;	// byte offset and number of the next puzzle in there
+	size_t number;
+	size_t chunk;	// chunks of all files before it
+	long written;	// bytes of output up to it
+};
+
+static string shard_name(const char* prefix, const uint shard, const uint num_shards){
+	char name[64];
+	snprintf(name, sizeof(name), ".%u-of-%u", shard, num_shards);
+	return prefix + string(name);
+}
+
+// the checkpoint of a shard, false if there is none
+static bool read_checkpoint(const string& filename, const uint shard, const uint num_shards,
+		const size_t num_files, batch_checkpoint& at){
+	FILE* f = fopen(filename.c_str(), "r");
+	if(!f) return false;
+	uint s, n;
+	size_t files;
+	const int fields = fscanf(f, "shard %u of %u, %zu files\n%zu %zu %zu %zu %ld", &s, &n, &files,
+		&at.file, &at.offset, &at.number, &at.chunk, &at.written);
+	fclose(f);
+	if(fields != 8) diewith("broken checkpoint \"" << filename << "\"" << endl);
+	if((s != shard) || (n != num_shards) || (files != num_files))
+		diewith("checkpoint \"" << filename << "\" is from another run" << endl);
+	return true;
+}
+
+// write the checkpoint next to the old one and move it over, so a crash
+// leaves one or the other
+static void write_checkpoint(const string& filename, const uint shard, const uint num_shards,
+		const size_t num_files, const batch_checkpoint& at){
+	const string temp = filename + ".new";
+	FILE* f = fopen(temp.c_str(), "w");
+	if(!f) diewith("error opening \"" << temp << "\" for writing" << endl);
+	fprintf(f, "shard %u of %u, %zu files\n%zu %zu %zu %zu %ld\n", shard, num_shards, num_files,
+		at.file, at.offset, at.number, at.chunk, at.written);
+	fflush(f);
+	fsync(fileno(f));
+	fclose(f);
+	if(rename(temp.c_str(), filename.c_str())) diewith("error writing \"" << filename << "\"" << endl);
+}
+
+bool batch_solver::solve_shard(const vector<const char*>& files, const uint shard, const uint num_shards, const char* prefix){
+	const string output = shard_name(prefix, shard, num_shards);
+	const string checkpoint = output + ".checkpoint";
+	batch_checkpoint at = {0, 0, 0, 0, 0};
+	FILE* out;
+	if(read_checkpoint(checkpoint, shard, num_shards, files.size(), at)){
+		if(at.file == files.size()) return true;
+		// lines written after the checkpoint are done again
+		out = fopen(output.c_str(), "r+");
+		if(!out || ftruncate(fileno(out), at.written) || fseek(out, at.written, SEEK_SET))
+			diewith("error resuming \"" << output << "\"" << endl);
+		fprintf(stderr, "shard %u of %u: resuming at puzzle %zu of %s\n", shard, num_shards, at.number, files[at.file]);
+	} else out = fopen(output.c_str(), "w");
+	if(!out) diewith("error opening \"" << output << "\" for writing" << endl);
+
+	vector<corpus_entry> entries;
+	vector<batch_result> results;
+	for(; at.file < files.size(); at.file++, at.offset = 0, at.number = 0){
+		corpus_reader reader(files[at.file]);
+		if(!reader.is_open()) diewith("error opening \"" << files[at.file] << "\"" << endl);
+		reader.seek(at.offset, at.number);
+		while(next_chunk(reader, entries)){
+			const bool mine = (at.chunk % num_shards == shard);
+			if(mine){
+				solve(entries, results);
+				for(size_t i = 0; i < entries.size(); i++){
+					fprintf(out, "%zu\t", at.chunk);
+					print_result(out, files[at.file], entries[i].number, results[i]);
+				}
+				fflush(out);
+				fsync(fileno(out));
+			}
+			at.chunk++;
+			at.offset = reader.tell();
+			at.number = reader.get_count();
+			at.written = ftell(out);
+			if(mine) write_checkpoint(checkpoint, shard, num_shards, files.size(), at);
+		}
+	}
+	fclose(out);
+	at.offset = at.number = 0;
+	write_checkpoint(checkpoint, shard, num_shards, files.size(), at);
+	return true;
+}
+
+bool run_shards(const vector<const char*>& files, const uint num_shards, const char* prefix,
+		const char* ladder_spec, const uint threads){
+	fflush(stdout);
+	fflush(stderr);
+	vector<pid_t> children;
+	for(uint shard = 0; shard < num_shards; shard++){
+		const pid_t pid = fork();
+		if(pid < 0) diewith("error starting shard " << shard << endl);
+		if(!pid){
+			batch_solver solver(ladder_spec, threads);
+			const bool done = solver.solve_shard(files, shard, num_shards, prefix);
+			fprintf(stderr, "shard %u of %u: ", shard, num_shards);
+			solver.print_summary(stderr);
+			exit(done ? 0 : 1);
+		}
+		children.push_back(pid);
+	}
+	bool result = true;
+	for(uint shard = 0; shard < num_shards; shard++){
+		int status;
+		if((waitpid(children[shard], &status, 0) < 0) || !WIFEXITED(status) || WEXITSTATUS(status)){
+			fprintf(stderr, "shard %u of %u did not finish\n", shard, num_shards);
+			result = false;
+		}
+	}
+	return result;
+}
+
+// the merged lines go to stdout, so its errors must not
+#define mergedie(x)  {cerr<< x; exit(1);}
+
+// the next line of a shard output without the chunk it is in, false at its
+// end
+static bool next_line(FILE* f, string& line, size_t& chunk){
+	char buffer[4096];
+	if(!fgets(buffer, sizeof(buffer), f)) return false;
+	char* tab;
+	chunk = strtoull(buffer, &tab, 10);
+	if((tab == buffer) || (*tab != '\t')) mergedie("broken line in shard output: " << buffer << endl);
+	line = tab + 1;
+	return true;
+}
+
+size_t merge_shards(const char* prefix, const uint num_shards, FILE* out){
+	if(!num_shards) mergedie("no shards to merge" << endl);
+	vector<FILE*> shards(num_shards);
+	vector<string> lines(num_shards);
+	vector<size_t> chunks(num_shards);
+	vector<bool> more(num_shards);
+	for(uint shard = 0; shard < num_shards; shard++){
+		const string output = shard_name(prefix, shard, num_shards);
+		FILE* f = fopen((output + ".checkpoint").c_str(), "r");
+		size_t num_files = 0, file = 1;
+		if(!f || (fscanf(f, "shard %*u of %*u, %zu files\n%zu", &num_files, &file) != 2) || (file != num_files))
+			mergedie("shard " << shard << " of " << num_shards << " has not finished [" << output << ".checkpoint]" << endl);
+		fclose(f);
+		shards[shard] = fopen(output.c_str(), "r");
+		if(!shards[shard]) mergedie("error opening \"" << output << "\"" << endl);
+		more[shard] = next_line(shards[shard], lines[shard], chunks[shard]);
+	}
+	// chunk g is in shard g % num_shards
+	size_t result = 0;
+	for(size_t chunk = 0; more[chunk % num_shards]; chunk++){
+		const uint shard = chunk % num_shards;
+		if(chunks[shard] != chunk) mergedie("shard outputs do not fit together: chunk " << chunk << " is missing" << endl);
+		while(more[shard] && (chunks[shard] == chunk)){
+			fputs(lines[shard].c_str(), out);
+			result++;
+			more[shard] = next_line(shards[shard], lines[shard], chunks[shard]);
+		}
+	}
+	for(uint shard = 0; shard < num_shards; shard++){
+		if(more[shard]) mergedie("shard outputs do not fit together" << endl);
+		fclose(shards[shard]);
+	}
+	return result;
+}
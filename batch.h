@@ -0,0 +1,89 @@
+/***************************************************
+ * batch.h
+ * solving whole corpora on threads
+ **************************************************
+ *
+ * batch_solver runs the agenda [see agenda.h] over every puzzle of one or
+ * more corpus files. The puzzles are taken from the file in chunks of
+ * BATCH_CHUNK; the threads of a chunk take one puzzle at a time [see
+ * parallel_for()], so a hard puzzle holds up nobody but its own thread,
+ * and each thread has its own ladder of rules. The results of a chunk are
+ * written in input order once all of it is done, one line per puzzle:
+ *
+ *   file<TAB>number<TAB>solved|stuck|invalid<TAB>tier<TAB>milliseconds
+ *
+ * with the number of the puzzle in its file counting from 0 and the tier
+ * the most expensive rule that got anywhere [see solv_agenda]. A puzzle
+ * that cannot be read or has no solution [see invalid_sudoku] is invalid,
+ * with tier -, and why goes to stderr; the run goes on with the next one.
+ * The rules are kept from writing to cout while a chunk is solved.
+ *
+ * Long runs are split into shards, each a process of its own: the chunks of
+ * all files, counted over all of them, go to shard chunk % num_shards. A
+ * shard writes its lines, each after the number of its chunk and a tab, to
+ * <prefix>.<shard>-of-<num_shards> and after each
+ * of its chunks the place it got to into that name plus .checkpoint [the
+ * next puzzle as file, offset and number, the chunks so far and the size of
+ * the output]. Run again, it goes on from there and drops whatever output
+ * came after the checkpoint, so a killed run loses one chunk per shard at
+ * most. merge_shards() puts the lines of the finished shards back into
+ * input order by their chunks and drops the numbers again.
+ */
+
+#ifndef batch_h
+#define batch_h
+
+#include <cstdio>
+
+#include "agenda.h"
+#include "corpus.h"
+
+// puzzles read ahead and solved in one go
+#define BATCH_CHUNK 1024
+
+// what became of a puzzle
+struct batch_result{
+	bool solved;
+	bool invalid;
+	string error;		// why it is invalid
+	uint tier;
+	double seconds;
+};
+
+class batch_solver{
+private:
+	uint threads;
+	vector<solv_ladder*> ladders;	// one per thread
+	// the run so far
+	size_t puzzles;
+	size_t solved;
+	size_t invalid;
+	vector<size_t> tiers;			// puzzles solved per tier
+	double seconds;
+
+	void solve_one(const corpus_entry& entry, const solv_ladder& ladder, batch_result& result) const;
+public:
+	batch_solver(const char* ladder_spec, const uint _threads);
+	~batch_solver();
+	const solv_ladder& get_ladder() const { return *ladders[0]; }
+	// solve the entries, results[i] is that of entries[i]
+	void solve(const vector<corpus_entry>& entries, vector<batch_result>& results);
+	// solve the puzzles of a corpus from its current position on, write
+	// their lines to out and return how many there were
+	size_t solve(const char* filename, corpus_reader& reader, FILE* out);
+	void print_result(FILE* out, const char* filename, const size_t number, const batch_result& result) const;
+	// puzzles, how they went and puzzles per second of the run so far
+	void print_summary(FILE* out) const;
+	// run a shard of the files [from its checkpoint on if there is one],
+	// return whether it finished
+	bool solve_shard(const vector<const char*>& files, const uint shard, const uint num_shards, const char* prefix);
+};
+
+// run all shards at once, one process each, return whether all finished
+bool run_shards(const vector<const char*>& files, const uint num_shards, const char* prefix,
+	const char* ladder_spec, const uint threads);
+// write the lines of the finished shards in input order, return how many
+// there were [errors go to stderr, not among the lines]
+size_t merge_shards(const char* prefix, const uint num_shards, FILE* out);
+
+#endif
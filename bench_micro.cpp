@@ -0,0 +1,265 @@
+#include "agenda.h"
+#include "align.h"
+#include "corpus.h"
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// time and allocations per operation of the building blocks of the solver,
+// on the first puzzles of a corpus: each measurement runs REPEAT times on
+// fresh copies of the same puzzles and the fastest run counts, only the
+// operations themselves are timed [the copies are made before]
+//
+//   bench_micro [file] [puzzles]
+//
+// "flooded" puzzles went through flood, eliminate and locate [see agenda.h]
+// so their graph has the triggers the search rules work on
+
+#define REPEAT 5
+
+// every operator new and new[] counts [the blocks of the fp_arena included,
+// not what the arena hands out of them], all forms of delete go with them
+static size_t allocations = 0;
+
+void* operator new(size_t size){
+	allocations++;
+	void* result = malloc(size ? size : 1);
+	if(!result) throw bad_alloc();
+	return result;
+}
+void* operator new[](size_t size){
+	return operator new(size);
+}
+void operator delete(void* p) noexcept{
+	free(p);
+}
+void operator delete[](void* p) noexcept{
+	free(p);
+}
+void operator delete(void* p, size_t) noexcept{
+	free(p);
+}
+void operator delete[](void* p, size_t) noexcept{
+	free(p);
+}
+
+// results nobody reads, so the compiler keeps what computes them
+static volatile size_t sink;
+
+double seconds_since(const chrono::steady_clock::time_point& start){
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* what, const size_t ops, const double seconds, const size_t allocs){
+	printf("%-28s %9zu ops %12.1f ns/op %9.2f allocs/op\n", what, ops,
+		ops ? seconds * 1e9 / ops : 0.0, ops ? (double)allocs / ops : 0.0);
+}
+
+// run op on copies of the puzzles, it returns the number of operations it did
+template<class Op>
+void measure(const char* what, const vector<solv_sudoku*>& puzzles, const Op& op){
+	double best = 0;
+	size_t ops = 0, allocs = 0;
+	for(uint r = 0; r < REPEAT; r++){
+		vector<solv_sudoku*> copies;
+		for(size_t i = 0; i < puzzles.size(); i++)
+			copies.push_back(new solv_sudoku(*puzzles[i]));
+		ops = 0;
+		const size_t before = allocations;
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(size_t i = 0; i < copies.size(); i++)
+			ops += op(copies[i], i);
+		const double seconds = seconds_since(start);
+		allocs = allocations - before;
+		if(!r || (seconds < best)) best = seconds;
+		for(size_t i = 0; i < copies.size(); i++)
+			delete copies[i];
+	}
+	report(what, ops, best, allocs);
+}
+
+// the empty cells of a puzzle
+vector<uint> empty_cells(const solv_sudoku* s){
+	vector<uint> result;
+	const uint num_cells = s->getnum_digits() * s->getnum_digits();
+	for(uint i = 0; i < num_cells; i++)
+		if(!s->get_contents()[i]) result.push_back(i);
+	return result;
+}
+
+int main(int argc, char** argv){
+	const char* filename = (argc > 1 ? argv[1] : "lists/solvable_tca");
+	const size_t max_puzzles = (argc > 2 ? atoi(argv[2]) : 50);
+	corpus_reader reader(filename);
+	if(!reader.is_open()) diewith("error opening \"" << filename << "\"" << endl);
+
+	// the rules report what they find on cout
+	cout.setstate(ios::failbit);
+	vector<corpus_entry> entries;
+	vector<solv_sudoku*> fresh, flooded;
+	vector<vector<byte> > solutions;
+	solv_ladder cheap("flood,eliminate,locate"), ladder;
+	corpus_entry entry;
+	size_t stuck = 0;
+	while((entries.size() < max_puzzles) && reader.next(entry)){
+		solv_sudoku* f = new solv_sudoku(entry, 0);
+		solv_agenda(f, cheap.get_rules()).run(LVL_ALL);
+		solv_sudoku solved(*f);
+		solv_agenda(&solved, ladder.get_rules()).run(LVL_ALL);
+		// the cascade needs the solution, puzzles the ladder gets stuck on
+		// are left out
+		if(solved.count_empty()){
+			delete f;
+			stuck++;
+			continue;
+		}
+		entries.push_back(entry);
+		fresh.push_back(new solv_sudoku(entry, 0));
+		flooded.push_back(f);
+		solutions.push_back(vector<byte>(solved.get_contents(), solved.get_contents() + entry.num_digits * entry.num_digits));
+	}
+	cout.clear();
+	if(entries.empty()) diewith("no puzzles the ladder solves in \"" << filename << "\"" << endl);
+	cout.setstate(ios::failbit);
+	const uint digits = fresh[0]->getnum_digits();
+	printf("%zu puzzles from %s, best of %u runs\n", entries.size(), filename, REPEAT);
+	if(stuck) printf("%zu puzzles left out, the ladder gets stuck on them\n", stuck);
+
+	// building and tearing down a puzzle [its givens triggered]
+	{
+		double best = 0;
+		size_t allocs = 0;
+		for(uint r = 0; r < REPEAT; r++){
+			const size_t before = allocations;
+			const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for(size_t i = 0; i < entries.size(); i++)
+				delete new solv_sudoku(entries[i], 0);
+			const double seconds = seconds_since(start);
+			allocs = allocations - before;
+			if(!r || (seconds < best)) best = seconds;
+		}
+		report("solv_sudoku build+destroy", entries.size(), best, allocs);
+	}
+	measure("solv_sudoku copy+destroy", flooded, [](solv_sudoku* s, size_t){
+		delete new solv_sudoku(*s);
+		return 1;
+	});
+
+	// the groups, as sets and as views
+	measure("getgroup", fresh, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		for(uint y = 0; y < digits; y++)
+			for(uint x = 0; x < digits; x++)
+				for(uint group_nr = 0; group_nr < 3; group_nr++, ops++)
+					delete s->getgroup(x, y, group_nr);
+		return ops;
+	});
+	measure("group view", fresh, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0, cells = 0;
+		for(uint y = 0; y < digits; y++)
+			for(uint x = 0; x < digits; x++)
+				for(uint group_nr = 0; group_nr < 3; group_nr++, ops++){
+					const group_view<solv_cell> group = s->group(x, y, group_nr);
+					for(group_view<solv_cell>::iterator i = group.begin(); i != group.end(); ++i)
+						cells += (*i)->get_index();
+				}
+		sink = cells;
+		return ops;
+	});
+
+	// what flood does: +d of a cell triggers -d in its peers
+	measure("fp_node::add_trigger", fresh, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		for(uint y = 0; y < digits; y++)
+			for(uint x = 0; x < digits; x++)
+				for(uint d = 1; d <= digits; d++){
+					fp_node* thesis = s->get_thesis(x, y, d);
+					if(!thesis || thesis->is_triggered()) continue;
+					const group_view<solv_cell> peers = s->peers(x, y);
+					for(group_view<solv_cell>::iterator i = peers.begin(); i != peers.end(); ++i)
+						if((**i)[-(int)d]){
+							(**i)[-(int)d]->add_trigger(thesis, LVL_FLOOD, LVL_ALL);
+							ops++;
+						}
+				}
+		return ops;
+	});
+
+	// filling in the solution cell by cell, each with all that follows
+	measure("fp_node::set_trigger cascade", flooded, [digits, &solutions](solv_sudoku* s, const size_t i){
+		size_t ops = 0;
+		const vector<uint> cells = empty_cells(s);
+		for(size_t c = 0; c < cells.size(); c++){
+			if(!solutions[i][cells[c]]) continue;
+			fp_node* thesis = s->get_thesis(cells[c] % digits, cells[c] / digits, solutions[i][cells[c]]);
+			if(thesis && !thesis->is_triggered()){
+				thesis->set_trigger(LVL_ALL);
+				ops++;
+			}
+		}
+		return ops;
+	});
+
+	// does a thesis lead to its opposite [what tca asks of each thesis]
+	measure("fp_gap", flooded, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		const vector<uint> cells = empty_cells(s);
+		for(size_t c = 0; c < cells.size(); c++)
+			for(uint d = 1; d <= digits; d++){
+				const fp_node* thesis = s->get_thesis(cells[c] % digits, cells[c] / digits, d);
+				if(!thesis || thesis->is_triggered()) continue;
+				fp_gap(thesis, s->get_opposite(thesis), LVL_ALL, 0);
+				ops++;
+			}
+		return ops;
+	});
+	measure("fp_search::gap", flooded, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		fp_search search(&s->get_graph());
+		const vector<uint> cells = empty_cells(s);
+		for(size_t c = 0; c < cells.size(); c++)
+			for(uint d = 1; d <= digits; d++){
+				const fp_node* thesis = s->get_thesis(cells[c] % digits, cells[c] / digits, d);
+				if(!thesis || thesis->is_triggered()) continue;
+				search.gap(thesis, s->get_opposite(thesis), LVL_ALL, 0);
+				ops++;
+			}
+		return ops;
+	});
+
+	// the rules working on units, on every unit [cell_align for every cell
+	// of it, digit_align for every digit]
+	measure("cell_align", flooded, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		for(uint n = 0; n < digits; n++)
+			for(uint group_nr = 0; group_nr < 3; group_nr++){
+				const group_view<solv_cell> group = s->group(n, group_nr);
+				for(group_view<solv_cell>::iterator i = group.begin(); i != group.end(); ++i, ops++)
+					cell_align(group, *i, LVL_ALL);
+			}
+		return ops;
+	});
+	measure("digit_align", flooded, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		for(uint n = 0; n < digits; n++)
+			for(uint group_nr = 0; group_nr < 3; group_nr++){
+				const group_view<solv_cell> group = s->group(n, group_nr);
+				for(uint d = 1; d <= digits; d++, ops++)
+					digit_align(group, d, LVL_ALL);
+			}
+		return ops;
+	});
+	measure("group_intersect", flooded, [digits](solv_sudoku* s, size_t){
+		size_t ops = 0;
+		for(uint y = 0; y < digits; y++)
+			for(uint x = 0; x < digits; x++)
+				for(uint d = 1; d <= digits; d++, ops++)
+					group_intersect(x, y, d, s, LVL_ALL);
+		return ops;
+	});
+
+	for(size_t i = 0; i < fresh.size(); i++){
+		delete fresh[i];
+		delete flooded[i];
+	}
+}
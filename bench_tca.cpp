@@ -0,0 +1,100 @@
+#include "solv_rules.h"
+#include "corpus.h"
+#include "parallel.h"
+#include <chrono>
+
+// wall time of tca on the puzzles of a corpus [after flood, eliminate and
+// locate]: the rule cell by cell, tca_all() and tca_parallel() on 1 to N
+// threads, each run to the end on copies of the same puzzles
+//
+//   bench_tca [file] [max threads] [max puzzles]
+
+double seconds_since(const chrono::steady_clock::time_point& start){
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// the grids the puzzles end in
+vector<byte> contents(const vector<solv_sudoku*>& puzzles){
+	vector<byte> result;
+	for(size_t i = 0; i < puzzles.size(); i++){
+		const uint num_cells = puzzles[i]->getnum_digits() * puzzles[i]->getnum_digits();
+		result.insert(result.end(), puzzles[i]->get_contents(), puzzles[i]->get_contents() + num_cells);
+	}
+	return result;
+}
+
+// run solve on copies of the puzzles, report and return the time taken
+template<class Solve>
+double run(const char* what, const vector<solv_sudoku*>& puzzles, const vector<byte>& reference, const Solve& solve){
+	vector<solv_sudoku*> copies;
+	for(size_t i = 0; i < puzzles.size(); i++)
+		copies.push_back(new solv_sudoku(*puzzles[i]));
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(size_t i = 0; i < copies.size(); i++)
+		solve(copies[i]);
+	const double seconds = seconds_since(start);
+	const bool agree = reference.empty() || (contents(copies) == reference);
+	printf("%-16s %8.1f ms  %8.1f puzzles/s   %s\n", what, seconds * 1000, copies.size() / seconds,
+		agree ? "results agree" : "RESULTS DIFFER");
+	for(size_t i = 0; i < copies.size(); i++)
+		delete copies[i];
+	return seconds;
+}
+
+int main(int argc, char** argv){
+	const char* filename = (argc > 1 ? argv[1] : "lists/solvable_tca");
+	const uint max_threads = (argc > 2 ? atoi(argv[2]) : default_threads());
+	const size_t max_puzzles = (argc > 3 ? atoi(argv[3]) : 500);
+	corpus_reader reader(filename);
+	if(!reader.is_open()) diewith("error opening \"" << filename << "\"" << endl);
+
+	// the rules report what they find on cout
+	cout.setstate(ios::failbit);
+	solv_rule floodrule(flood), eliminaterule(eliminate), locaterule(locate);
+	vector<solv_sudoku*> puzzles;
+	corpus_entry entry;
+	while((puzzles.size() < max_puzzles) && reader.next(entry)){
+		solv_sudoku* s = new solv_sudoku(entry, 0);
+		while(s->applyrule(&floodrule, LVL_ALL));
+		while(s->applyrule(&eliminaterule, LVL_ALL));
+		while(s->applyrule(&locaterule, LVL_ALL));
+		puzzles.push_back(s);
+	}
+	if(puzzles.empty()) diewith("no puzzles in \"" << filename << "\"" << endl);
+	printf("%zu puzzles from %s, %u cores\n", puzzles.size(), filename, default_threads());
+
+	// the reference: tca as a rule, one cell at a time
+	vector<byte> reference;
+	{
+		vector<solv_sudoku*> copies;
+		for(size_t i = 0; i < puzzles.size(); i++){
+			copies.push_back(new solv_sudoku(*puzzles[i]));
+			solv_rule tcarule(tca);
+			while(copies.back()->applyrule(&tcarule, LVL_ALL));
+		}
+		reference = contents(copies);
+		for(size_t i = 0; i < copies.size(); i++)
+			delete copies[i];
+	}
+
+	run("tca", puzzles, reference, [](solv_sudoku* s){
+		solv_rule tcarule(tca);
+		while(s->applyrule(&tcarule, LVL_ALL));
+	});
+	run("tca_all", puzzles, reference, [](solv_sudoku* s){
+		while(tca_all(s, LVL_ALL));
+	});
+	double single = 0;
+	for(uint threads = 1; threads <= max_threads; threads = (threads < max_threads && 2 * threads > max_threads) ? max_threads : 2 * threads){
+		char what[32];
+		snprintf(what, sizeof(what), "tca_parallel/%u", threads);
+		const double seconds = run(what, puzzles, reference, [threads](solv_sudoku* s){
+			while(tca_parallel(s, LVL_ALL, threads));
+		});
+		if(threads == 1) single = seconds;
+		else printf("%16s speedup %.2f on %u threads\n", "", single / seconds, threads);
+	}
+
+	for(size_t i = 0; i < puzzles.size(); i++)
+		delete puzzles[i];
+}
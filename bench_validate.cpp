@@ -0,0 +1,80 @@
+#include "validate.h"
+#include "grid_core.h"
+#include "corpus.h"
+#include <chrono>
+
+// throughput of the grid checks: one grid at a time through the scalar
+// kernels against check_batch(), on the puzzles of a corpus [consistency]
+// and on solved grids made from them by relabeling a pattern [validity]
+
+#define MIN_GRIDS (1 << 20)
+
+double seconds_since(const chrono::steady_clock::time_point& start){
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void run(const char* what, const vector<byte>& grids, const uint num_digits, const bool complete){
+	const grid_kernels* kernels = grid_kernels::get(num_digits);
+	const uint num_cells = num_digits * num_digits;
+	const size_t count = grids.size() / num_cells;
+	vector<byte> scalar(count), batch(count);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(size_t i = 0; i < count; i++)
+		scalar[i] = complete ? kernels->is_valid(&grids[i * num_cells]) : kernels->is_consistent(&grids[i * num_cells]);
+	const double t_scalar = seconds_since(start);
+
+	start = chrono::steady_clock::now();
+	const size_t passed = check_batch(&grids[0], count, num_digits, complete, &batch[0]);
+	const double t_batch = seconds_since(start);
+
+	printf("%-12s %9zu grids, %9zu pass   scalar %7.2f Mgrids/s   batch %7.2f Mgrids/s   %s\n", what, count, passed,
+		count / t_scalar / 1e6, count / t_batch / 1e6, (scalar == batch) ? "results agree" : "RESULTS DIFFER");
+}
+
+int main(int argc, char** argv){
+	const char* filename = (argc > 1 ? argv[1] : "lists/solvable_tca");
+	corpus_reader reader(filename);
+	if(!reader.is_open()) diewith("error opening \"" << filename << "\"" << endl);
+	const uint num_digits = reader.getnum_digits();
+	const uint num_cells = num_digits * num_digits;
+	const uint order = (uint)sqrt(num_digits);
+
+	// the puzzles, repeated until there are enough of them
+	vector<byte> puzzles;
+	corpus_entry entry;
+	while(reader.next(entry)){
+		puzzles.resize(puzzles.size() + num_cells);
+		if(!entry.parse(&puzzles[puzzles.size() - num_cells])) diewith("error reading puzzle " << entry.number << endl);
+	}
+	if(puzzles.empty()) diewith("no puzzles in \"" << filename << "\"" << endl);
+	const size_t loaded = puzzles.size();
+	while(puzzles.size() < MIN_GRIDS * (size_t)num_cells)
+		puzzles.insert(puzzles.end(), puzzles.begin(), puzzles.begin() + loaded);
+
+	// solved grids: the standard pattern with random digits, every 8th one broken
+	srand(1);
+	vector<byte> solved(puzzles.size());
+	vector<byte> relabel(num_digits + 1);
+	for(size_t g = 0; g < solved.size() / num_cells; g++){
+		for(uint d = 1; d <= num_digits; d++) relabel[d] = d;
+		for(uint d = num_digits; d > 1; d--) swap(relabel[d], relabel[1 + rand() % d]);
+		byte* grid = &solved[g * num_cells];
+		for(uint y = 0; y < num_digits; y++)
+			for(uint x = 0; x < num_digits; x++)
+				grid[y * num_digits + x] = relabel[(x + (y % order) * order + y / order) % num_digits + 1];
+		if(!(g % 8)) grid[rand() % num_cells] = 0;
+	}
+
+	run("consistent", puzzles, num_digits, false);
+	run("valid", solved, num_digits, true);
+
+	// report the failing units of the first broken grid
+	sudoku s(num_digits);
+	for(uint i = 0; i < num_cells; i++) s.set_content(i, solved[i]);
+	vector<uint> units;
+	failing_units(s, true, &units);
+	printf("first solved grid fails in");
+	for(uint i = 0; i < units.size(); i++) printf(" %s", unit_name(units[i], num_digits).c_str());
+	printf("\n");
+}
@@ -0,0 +1,311 @@
+/***************************************************
+ * canonical.cpp
+ * canonical forms of grids under the sudoku symmetries
+ **************************************************/
+
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+
+#include "canonical.h"
+
+sudoku_transform::sudoku_transform(const uint num_digits):transposed(false),
+	row_perm(num_digits), col_perm(num_digits), digit_map(num_digits + 1){
+	for(uint i = 0; i < num_digits; ++i){
+		row_perm[i] = i;
+		col_perm[i] = i;
+	}
+	for(uint d = 0; d <= num_digits; ++d) digit_map[d] = d;
+}
+
+void sudoku_transform::apply(const byte* in, const uint num_digits, byte* out) const{
+	for(uint y = 0; y < num_digits; ++y)
+		for(uint x = 0; x < num_digits; ++x){
+			const uint row = row_perm[y];
+			const uint col = col_perm[x];
+			out[y * num_digits + x] = digit_map[transposed ? in[col * num_digits + row] : in[row * num_digits + col]];
+		}
+}
+
+void sudoku_transform::apply(const sudoku& in, sudoku& out) const{
+	const uint num_digits = in.getnum_digits();
+	vector<byte> result(num_digits * num_digits);
+	apply(in.get_contents(), num_digits, &result[0]);
+	out = sudoku(num_digits);
+	out.set_contents(&result[0]);
+}
+
+
+// a partial transform: the first rows / columns of the result and the labels
+// given so far
+struct canon_state{
+	byte transposed;
+	byte next_label;
+	uint64_t used_rows;
+	uint64_t used_cols;
+	byte rows[MASK_DIGITS];
+	byte cols[MASK_DIGITS];
+	byte map[MASK_DIGITS + 1];	// 0 = no label yet
+};
+
+// a way to extend a state by one cell
+struct canon_choice{
+	uint state;
+	byte row;
+	byte col;
+};
+
+class canon_search{
+	const byte* content;
+	const uint num_digits;
+	const uint order;
+	const bool relabel;
+	const byte empty_key;	// empty cells compare greater than any digit
+	// buffers of step(), kept to not allocate them for every cell
+	vector<canon_choice> choices;
+	vector<canon_state> next;
+	unordered_set<string> seen;
+
+	uint64_t band_mask(const uint band) const{
+		const uint64_t lines = (order < 64) ? ((uint64_t)1 << order) - 1 : ~(uint64_t)0;
+		return lines << (band * order);
+	}
+
+	// the lines that may be placed at position pos given the lines used so far
+	uint64_t options(const uint pos, const uint64_t used, const byte* placed) const{
+		uint64_t result = 0;
+		if(pos % order){
+			// fill up the band of the previous line
+			result = band_mask(placed[pos - 1] / order) & ~used;
+		} else {
+			for(uint band = 0; band < order; ++band)
+				if(!(used & band_mask(band))) result |= band_mask(band);
+		}
+		return result;
+	}
+
+	byte source(const canon_state& s, const uint row, const uint col) const{
+		return s.transposed ? content[col * num_digits + row] : content[row * num_digits + col];
+	}
+
+	byte key(const canon_state& s, const byte digit) const{
+		if(!digit) return empty_key;
+		if(!relabel) return digit;
+		return s.map[digit] ? s.map[digit] : s.next_label;
+	}
+
+	// states with the same future: same labels, same columns and the same set of rows
+	string merge_key(const canon_state& s) const{
+		string result((const char*)&s.transposed, 2);
+		result.append((const char*)&s.used_rows, sizeof(s.used_rows));
+		result.append((const char*)s.cols, num_digits);
+		if(relabel) result.append((const char*)s.map + 1, num_digits);
+		return result;
+	}
+
+	// some line the first row of the result may come from is full [with
+	// relabeling it turns into 1, 2, ..., n whatever the order of the columns]
+	bool has_full_line(const bool transpose) const{
+		for(uint t = 0; t <= (uint)transpose; ++t)
+			for(uint line = 0; line < num_digits; ++line){
+				uint x = 0;
+				while((x < num_digits) && (t ? content[x * num_digits + line] : content[line * num_digits + x])) ++x;
+				if(x == num_digits) return true;
+			}
+		return false;
+	}
+
+	// all orders of the lines that keep the bands [or stacks] together
+	void line_perms(vector<byte>& result) const{
+		vector<byte> bands(order), inner(order), perm(num_digits);
+		for(uint i = 0; i < order; ++i) bands[i] = i;
+		vector<vector<byte> > inners;
+		for(uint i = 0; i < order; ++i) inner[i] = i;
+		do inners.push_back(inner); while(next_permutation(inner.begin(), inner.end()));
+		result.clear();
+		do{
+			// one order inside each band: a number in base inners.size()
+			vector<uint> pick(order, 0);
+			for(;;){
+				for(uint b = 0; b < order; ++b)
+					for(uint i = 0; i < order; ++i)
+						perm[b * order + i] = bands[b] * order + inners[pick[b]][i];
+				result.insert(result.end(), perm.begin(), perm.end());
+				uint b = 0;
+				while((b < order) && (++pick[b] == inners.size())) pick[b++] = 0;
+				if(b == order) break;
+			}
+		} while(next_permutation(bands.begin(), bands.end()));
+	}
+
+public:
+	vector<canon_state> states;
+
+	// fix the first band of the result at once: try every band, every order
+	// of its rows and every order of the columns, keep all that reach the
+	// smallest band [a full grid would tie on all column orders in the first
+	// row, the search would carry 2 * 9 * 1296 states into the second];
+	// return the number of rows fixed
+	uint seed_band(byte* canon){
+		vector<byte> cols;
+		line_perms(cols);
+		const uint num_cols = cols.size() / num_digits;
+		const uint band_cells = order * num_digits;
+		vector<byte> best(band_cells, 0xff);
+		vector<byte> rows(order);
+		vector<byte> grid(num_digits * num_digits);
+		vector<canon_state> seeds;
+		for(uint i = 0; i < states.size(); ++i){
+			// the source as rows, so the loops below read it directly
+			for(uint row = 0; row < num_digits; ++row)
+				for(uint col = 0; col < num_digits; ++col)
+					grid[row * num_digits + col] = source(states[i], row, col);
+			for(uint band = 0; band < order; ++band){
+				for(uint r = 0; r < order; ++r) rows[r] = band * order + r;
+				do for(uint c = 0; c < num_cols; ++c){
+					const byte* col = &cols[c * num_digits];
+					byte map[MASK_DIGITS + 1];
+					memset(map, 0, num_digits + 1);
+					byte next_label = 1;
+					// compare cell by cell as long as it ties
+					bool less = false, greater = false;
+					for(uint y = 0; (y < order) && !greater; ++y){
+						const byte* row = &grid[rows[y] * num_digits];
+						byte* b = &best[y * num_digits];
+						for(uint x = 0; x < num_digits; ++x){
+							const byte digit = row[col[x]];
+							byte k = digit;
+							if(!digit) k = empty_key;
+							else if(relabel){
+								if(!map[digit]) map[digit] = next_label++;
+								k = map[digit];
+							}
+							if(less) b[x] = k;
+							else if(k < b[x]){
+								less = true;
+								b[x] = k;
+							} else if(k > b[x]){
+								greater = true;
+								break;
+							}
+						}
+					}
+					if(greater) continue;
+					if(less) seeds.clear();
+					canon_state s = states[i];
+					for(uint y = 0; y < order; ++y){
+						s.rows[y] = rows[y];
+						s.used_rows |= (uint64_t)1 << rows[y];
+					}
+					for(uint x = 0; x < num_digits; ++x){
+						s.cols[x] = col[x];
+						s.used_cols |= (uint64_t)1 << col[x];
+					}
+					memcpy(s.map, map, num_digits + 1);
+					s.next_label = next_label;
+					seeds.push_back(s);
+				} while(next_permutation(rows.begin(), rows.end()));
+			}
+		}
+		for(uint cell = 0; cell < band_cells; ++cell)
+			canon[cell] = (best[cell] == empty_key) ? 0 : best[cell];
+		states.swap(seeds);
+		return order;
+	}
+
+	canon_search(const byte* _content, const uint _num_digits, const uint symmetries):
+		content(_content), num_digits(_num_digits), order((uint)sqrt(_num_digits)),
+		relabel(symmetries & CANON_RELABEL), empty_key(_num_digits + 1){
+
+		canon_state start;
+		memset(&start, 0, sizeof(start));
+		start.next_label = 1;
+		states.push_back(start);
+		if(symmetries & CANON_TRANSPOSE){
+			start.transposed = 1;
+			states.push_back(start);
+		}
+	}
+
+	// whether seed_band() beats fixing the first band cell by cell: only with
+	// relabeling and a full line, and only up to 9x9 [there are 1296 column
+	// orders for 9x9, but 7962624 for 16x16]
+	bool wants_seed() const{
+		return relabel && (order <= 3) && has_full_line(states.size() > 1);
+	}
+
+	// fix cell (x, y) of the result, keep the states reaching the smallest key
+	void step(const uint x, const uint y, byte* canon){
+		choices.clear();
+		byte best = 0xff;
+		for(uint i = 0; i < states.size(); ++i){
+			const canon_state& s = states[i];
+			const uint64_t rows = x ? (uint64_t)1 << s.rows[y] : options(y, s.used_rows, s.rows);
+			const uint64_t cols = y ? (uint64_t)1 << s.cols[x] : options(x, s.used_cols, s.cols);
+			for(uint64_t row_bits = rows; row_bits; row_bits &= row_bits - 1){
+				const uint row = __builtin_ctzll(row_bits);
+				for(uint64_t col_bits = cols; col_bits; col_bits &= col_bits - 1){
+					const uint col = __builtin_ctzll(col_bits);
+					const byte k = key(s, source(s, row, col));
+					if(k > best) continue;
+					if(k < best){
+						best = k;
+						choices.clear();
+					}
+					canon_choice c = {i, (byte)row, (byte)col};
+					choices.push_back(c);
+				}
+			}
+		}
+		canon[y * num_digits + x] = (best == empty_key) ? 0 : best;
+
+		// states can only meet when a row is placed below the first one
+		const bool merge = !x && y;
+		next.clear();
+		seen.clear();
+		for(uint i = 0; i < choices.size(); ++i){
+			canon_state s = states[choices[i].state];
+			s.rows[y] = choices[i].row;
+			s.cols[x] = choices[i].col;
+			s.used_rows |= (uint64_t)1 << choices[i].row;
+			s.used_cols |= (uint64_t)1 << choices[i].col;
+			const byte digit = source(s, choices[i].row, choices[i].col);
+			if(relabel && digit && !s.map[digit]) s.map[digit] = s.next_label++;
+			if(!merge || seen.insert(merge_key(s)).second)
+				next.push_back(s);
+		}
+		states.swap(next);
+	}
+};
+
+void canonical_form(const byte* content, const uint num_digits, byte* canon, sudoku_transform* transform, const uint symmetries){
+	canon_search search(content, num_digits, symmetries);
+	for(uint y = search.wants_seed() ? search.seed_band(canon) : 0; y < num_digits; ++y)
+		for(uint x = 0; x < num_digits; ++x)
+			search.step(x, y, canon);
+
+	if(transform){
+		const canon_state& s = search.states.front();
+		*transform = sudoku_transform(num_digits);
+		transform->transposed = s.transposed;
+		for(uint i = 0; i < num_digits; ++i){
+			transform->row_perm[i] = s.rows[i];
+			transform->col_perm[i] = s.cols[i];
+		}
+		if(symmetries & CANON_RELABEL){
+			// digits missing from the grid take the remaining labels
+			byte label = s.next_label;
+			for(uint d = 1; d <= num_digits; ++d)
+				transform->digit_map[d] = s.map[d] ? s.map[d] : label++;
+		}
+	}
+}
+
+void canonical_form(const sudoku& s, sudoku& canon, sudoku_transform* transform, const uint symmetries){
+	const uint num_digits = s.getnum_digits();
+	vector<byte> result(num_digits * num_digits);
+	canonical_form(s.get_contents(), num_digits, &result[0], transform, symmetries);
+	canon = sudoku(num_digits);
+	canon.set_contents(&result[0]);
+}
@@ -0,0 +1,67 @@
+/***************************************************
+ * canonical.h
+ * canonical forms of grids under the sudoku symmetries
+ **************************************************
+ *
+ * Two grids are equivalent if one becomes the other by
+ *  - permuting the bands and the rows inside each band,
+ *  - permuting the stacks and the columns inside each stack,
+ *  - transposing [this and the above give all rotations and flips],
+ *  - relabeling the digits.
+ * canonical_form() maps every grid to the smallest equivalent one, so two
+ * grids are equivalent iff their canonical forms are equal, and a corpus
+ * is deduplicated by hashing canonical forms.
+ *
+ * "Smallest" compares the grids cell by cell in row-major order, digits
+ * after relabeling [they are labeled 1, 2, ... in order of appearance]
+ * and empty cells last. The search fixes one cell of the result at a time
+ * and keeps all partial transforms reaching the smallest prefix; those that
+ * differ only in the order of rows already placed are merged, since they
+ * have the same future.
+ *
+ * With relabeling a full row turns into 1, 2, ..., n under every order of
+ * the columns, so cell by cell a full grid would tie on all of them. Up to
+ * 9x9, if any line is full, the first band is instead found by trying all
+ * bands, row orders and column orders at once [2 * 3 * 6 * 1296 for 9x9,
+ * each given up at its first cell above the best].
+ *
+ * Cost on 9x9: a puzzle takes about 0.05ms, a full grid about 2.4ms [it
+ * was 33ms, both measured in the same sandbox]. So deduplicating solutions,
+ * or is_equal(EQ_ALL) on them, costs about 50 times as much as it does on
+ * puzzles. Larger full grids still go cell by cell and are far slower.
+ */
+
+#ifndef canonical_h
+#define canonical_h
+
+#include <vector>
+
+#include "sudoku.h"
+
+using namespace std;
+
+// symmetries canonical_form() may use besides the line permutations
+#define CANON_TRANSPOSE	1
+#define CANON_RELABEL	2
+#define CANON_ALL		(CANON_TRANSPOSE | CANON_RELABEL)
+
+// a symmetry of the grid: result(x, y) = digit_map[source(col_perm[x], row_perm[y])],
+// where source is the transposed grid if transposed is set
+struct sudoku_transform{
+	bool transposed;
+	vector<byte> row_perm;
+	vector<byte> col_perm;
+	vector<byte> digit_map;	// digit_map[0] = 0
+
+	// the identity
+	sudoku_transform(const uint num_digits = 0);
+	// out must not overlap in
+	void apply(const byte* in, const uint num_digits, byte* out) const;
+	void apply(const sudoku& in, sudoku& out) const;
+};
+
+// compute the canonical form of a grid [and the transform leading there]
+void canonical_form(const byte* content, const uint num_digits, byte* canon, sudoku_transform* transform = NULL, const uint symmetries = CANON_ALL);
+void canonical_form(const sudoku& s, sudoku& canon, sudoku_transform* transform = NULL, const uint symmetries = CANON_ALL);
+
+#endif
@@ -0,0 +1,242 @@
+/***************************************************
+ * corpus.cpp
+ * streaming access to files holding many puzzles
+ **************************************************/
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "corpus.h"
+#include "sudoku_io.h"
+
+// flush the writer once this much output has piled up
+#define CORPUS_WRITE_BUFFER (1 << 20)
+
+static inline bool is_blank(const char c){
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+// return the end of the line starting at p [the '\n' or end]
+static inline const char* line_end(const char* p, const char* end){
+	const char* eol = (const char*)memchr(p, '\n', end - p);
+	return eol ? eol : end;
+}
+
+// true iff the line [p, eol) holds nothing but whitespace
+static inline bool is_empty_line(const char* p, const char* eol){
+	while((p != eol) && is_blank(*p)) ++p;
+	return p == eol;
+}
+
+// return the start of the first non-empty line at or after p, end if there is none
+static const char* skip_empty_lines(const char* p, const char* end){
+	while(p != end){
+		const char* eol = line_end(p, end);
+		if(!is_empty_line(p, eol)) return p;
+		p = (eol == end) ? end : eol + 1;
+	}
+	return end;
+}
+
+// n if value == n * n, 0 otherwise
+static uint exact_sqrt(const uint value){
+	uint n = 0;
+	while((n + 1) * (n + 1) <= value) ++n;
+	return (n * n == value) ? n : 0;
+}
+
+
+bool corpus_entry::parse(byte* digits) const{
+	if(format == CORPUS_LINES)
+		return parse_line(begin, end, num_digits, digits);
+	else
+		return parse_grid(begin, end, num_digits, digits);
+}
+
+
+corpus_reader::corpus_reader(const char* filename):
+	data(NULL), size(0), mapped(false), pos(NULL), count(0), format(CORPUS_GRIDS), num_digits(0){
+
+	dbgout << "opening corpus \"" << filename << "\"" << endl;
+	if(!strcmp(filename, "stdin")){
+		if(!read_whole_file(filename, buffer)) return;
+		data = buffer.data();
+		size = buffer.size();
+	} else {
+		const int fd = open(filename, O_RDONLY);
+		if(fd < 0) return;
+		struct stat st;
+		if(fstat(fd, &st)){
+			close(fd);
+			return;
+		}
+		if(st.st_size > 0){
+			void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(map != MAP_FAILED){
+				madvise(map, st.st_size, MADV_SEQUENTIAL);
+				data = (const char*)map;
+				size = st.st_size;
+				mapped = true;
+			}
+		} else data = buffer.data();	// an empty corpus
+		close(fd);
+		if(!data) return;
+	}
+	pos = data;
+	detect();
+}
+
+corpus_reader::~corpus_reader(){
+	if(mapped) munmap((void*)data, size);
+}
+
+// find out the layout and the number of digits from the first puzzle:
+// a first line of L cells is a row if L is a valid number of digits and
+// exactly L rows follow it [a grid ends at a blank line], otherwise it is
+// a whole puzzle of L = n * n cells
+//
+// L = 16 fits both, a row of a 16x16 grid and a 4x4 puzzle. A 17th line
+// right after the first 16 makes it a lines corpus. Exactly 16 lines, each
+// of them a 4x4 puzzle, are 16x16 grid only if a digit above 4 occurs in it
+void corpus_reader::detect(){
+	const char* end = data + size;
+	const char* first = skip_empty_lines(data, end);
+	if(first == end) return;
+
+	const uint cells = grid_digits(first, end);
+	uint rows = 0;
+	const char* p = first;
+	while((p != end) && (rows <= cells)){
+		const char* eol = line_end(p, end);
+		if(is_empty_line(p, eol)) break;
+		++rows;
+		p = (eol == end) ? end : eol + 1;
+	}
+
+	const bool grids_ok = exact_sqrt(cells) && (cells <= MASK_DIGITS);
+	const uint line_digits = exact_sqrt(cells);
+	const bool lines_ok = line_digits && exact_sqrt(line_digits) && (line_digits <= MASK_DIGITS);
+	bool grids = grids_ok && (!lines_ok || (rows == cells));
+	if(grids && lines_ok){
+		vector<byte> digits(cells * cells);
+		grids = parse_grid(first, end, cells, &digits[0]) &&
+			(*max_element(digits.begin(), digits.end()) > line_digits);
+	}
+	if(grids){
+		format = CORPUS_GRIDS;
+		num_digits = cells;
+	} else if(lines_ok){
+		format = CORPUS_LINES;
+		num_digits = line_digits;
+	}
+	dbgout << "corpus layout " << (format == CORPUS_LINES ? "lines" : "grids") << ", " << num_digits << " digits" << endl;
+}
+
+bool corpus_reader::is_open() const{
+	return data != NULL;
+}
+uint corpus_reader::get_format() const{
+	return format;
+}
+uint corpus_reader::getnum_digits() const{
+	return num_digits;
+}
+
+bool corpus_reader::next(corpus_entry& entry){
+	if(!num_digits) return false;
+	const char* end = data + size;
+	const char* p = skip_empty_lines(pos, end);
+	if(p == end) {
+		pos = end;
+		return false;
+	}
+
+	entry.begin = p;
+	entry.num_digits = num_digits;
+	entry.format = format;
+	entry.number = count;
+
+	// a grid is the next num_digits non-empty lines, a line is just one
+	const uint lines = (format == CORPUS_LINES) ? 1 : num_digits;
+	uint rows = 0;
+	const char* eol = p;
+	while((p != end) && (rows < lines)){
+		eol = line_end(p, end);
+		if(!is_empty_line(p, eol)) ++rows;
+		p = (eol == end) ? end : eol + 1;
+	}
+	entry.end = eol;
+	pos = p;
+	if(rows < lines){
+		dbgout << "corpus ends inside puzzle " << count << endl;
+		return false;
+	}
+	++count;
+	return true;
+}
+
+size_t corpus_reader::tell() const{
+	return pos - data;
+}
+size_t corpus_reader::get_count() const{
+	return count;
+}
+void corpus_reader::seek(const size_t offset, const size_t number){
+	pos = data + ((offset < size) ? offset : size);
+	count = number;
+}
+void corpus_reader::rewind(){
+	seek(0, 0);
+}
+
+
+corpus_writer::corpus_writer(const char* filename, const uint _format):format(_format),written(0){
+	is_file = strcmp(filename, "stdout");
+	if(is_file) file = fopen(filename, "wb"); else file = stdout;
+	if(!file) diewith("error opening \"" << filename << "\" for writing" << endl);
+	buffer.reserve(CORPUS_WRITE_BUFFER + 4096);
+}
+
+corpus_writer::~corpus_writer(){
+	flush();
+	if(is_file && file) fclose(file);
+}
+
+bool corpus_writer::is_open() const{
+	return file != NULL;
+}
+
+void corpus_writer::write(const sudoku& s){
+	if(format == CORPUS_LINES)
+		format_line(s.get_contents(), s.getnum_digits(), buffer);
+	else {
+		// puzzles are separated by blank lines, like in lists/
+		if(written) buffer += '\n';
+		format_grid(s.get_contents(), s.getnum_digits(), buffer);
+	}
+	++written;
+	if(buffer.size() >= CORPUS_WRITE_BUFFER) flush();
+}
+
+void corpus_writer::write(const char* text, const size_t length){
+	buffer.append(text, length);
+	if(buffer.size() >= CORPUS_WRITE_BUFFER) flush();
+}
+void corpus_writer::write(const string& text){
+	write(text.data(), text.size());
+}
+
+void corpus_writer::flush(){
+	if(buffer.empty()) return;
+	if(fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+		diewith("error writing corpus output" << endl);
+	fflush(file);
+	buffer.clear();
+}
+
+size_t corpus_writer::get_written() const{
+	return written;
+}
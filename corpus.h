@@ -0,0 +1,101 @@
+/***************************************************
+ * corpus.h
+ * streaming access to files holding many puzzles
+ **************************************************
+ *
+ * A corpus is a text file of puzzles in one of two layouts:
+ *
+ *  CORPUS_GRIDS  one row per line, puzzles separated by blank lines
+ *                [the layout of the files in lists/, a file holding a
+ *                single grid is a corpus of one puzzle]
+ *  CORPUS_LINES  one puzzle per line, all cells of the puzzle in a row
+ *                [the common 81 character format for 9x9]
+ *
+ * Rows and lines use the symbols or numbers of sudoku_io.h. The layout
+ * and the number of digits are detected from the first puzzle [16 cells in
+ * a line are a row of a 16x16 grid only if exactly 16 such lines come
+ * before the first blank line and a digit above 4 occurs in them,
+ * otherwise they are a 4x4 puzzle].
+ *
+ * corpus_reader maps the file into memory and hands out corpus_entry
+ * objects pointing into the mapping, so walking a corpus copies nothing
+ * until a puzzle is actually parsed. stdin cannot be mapped, it is read
+ * into memory once instead. corpus_writer collects output in a large
+ * buffer and writes it in big blocks.
+ */
+
+#ifndef corpus_h
+#define corpus_h
+
+#include <string>
+
+#include "sudoku.h"
+
+using namespace std;
+
+#define CORPUS_GRIDS 0
+#define CORPUS_LINES 1
+
+// a puzzle inside a corpus [points into the memory of the reader]
+struct corpus_entry{
+	const char* begin;
+	const char* end;
+	uint num_digits;
+	uint format;
+	size_t number;	// position of the puzzle in the corpus, counting from 0
+
+	// parse the puzzle into num_digits * num_digits digits [row-major]
+	bool parse(byte* digits) const;
+};
+
+class corpus_reader{
+private:
+	const char* data;
+	size_t size;
+	bool mapped;	// data is an mmap of the file [otherwise it points into buffer]
+	string buffer;	// contents of stdin
+	const char* pos;
+	size_t count;	// number of the next puzzle
+	uint format;
+	uint num_digits;
+
+	void detect();
+public:
+	// open a corpus file, "stdin" reads the standard input
+	corpus_reader(const char* filename);
+	~corpus_reader();
+	bool is_open() const;
+	uint get_format() const;
+	uint getnum_digits() const;
+	// fetch the next puzzle, return false at the end of the corpus
+	bool next(corpus_entry& entry);
+	// byte offset and number of the next puzzle, and a way back to them
+	size_t tell() const;
+	size_t get_count() const;
+	void seek(const size_t offset, const size_t number);
+	void rewind();
+};
+
+class corpus_writer{
+private:
+	FILE* file;
+	bool is_file;
+	uint format;
+	string buffer;
+	size_t written;	// puzzles written so far
+public:
+	// write to a file, "stdout" writes to the standard output
+	corpus_writer(const char* filename, const uint _format = CORPUS_GRIDS);
+	~corpus_writer();
+	bool is_open() const;
+	// append a puzzle in the layout of the writer
+	void write(const sudoku& s);
+	// append raw text
+	void write(const char* text, const size_t length);
+	void write(const string& text);
+	// hand the buffered output to the operating system
+	void flush();
+	size_t get_written() const;
+};
+
+#endif
@@ -0,0 +1,114 @@
+/***************************************************
+ * cow_array.h
+ * arrays sharing their unchanged parts with their copies
+ **************************************************
+ *
+ * A cow_array keeps its elements in chunks of COW_CHUNK, each chunk held
+ * by a shared_ptr. Copying the array copies the chunk pointers only; a
+ * chunk is copied when it is written while another array still holds it.
+ * So a copy costs one pointer per chunk, and each copy pays only for the
+ * chunks it changes.
+ *
+ * Reading goes through operator[], writing through write(i) [which may
+ * copy the chunk of i]. Elements of one chunk are contiguous: append_run(k)
+ * makes sure the next k elements land in one chunk, so a run can be read
+ * through a plain pointer.
+ *
+ * Copies may live in different threads as long as each array is used by
+ * one thread at a time.
+ */
+
+#ifndef cow_array_h
+#define cow_array_h
+
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#define COW_CHUNK_BITS 10
+#define COW_CHUNK (1 << COW_CHUNK_BITS)
+
+template<class T>
+class cow_array{
+private:
+	typedef vector<T> chunk;
+	vector<shared_ptr<chunk> > chunks;
+	size_t count;
+
+	// the chunk, made private to this array
+	chunk& writable(const size_t c){
+		if(chunks[c].use_count() > 1) chunks[c] = make_shared<chunk>(*chunks[c]);
+		return *chunks[c];
+	}
+public:
+	cow_array():count(0) {};
+	cow_array(const size_t n, const T& value):count(0){
+		assign(n, value);
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return !count; }
+	const T& operator[](const size_t i) const{
+		return (*chunks[i >> COW_CHUNK_BITS])[i & (COW_CHUNK - 1)];
+	}
+	T& write(const size_t i){
+		return writable(i >> COW_CHUNK_BITS)[i & (COW_CHUNK - 1)];
+	}
+	const T& back() const{
+		return (*this)[count - 1];
+	}
+	// the first index after the chunk of i [elements up to there are contiguous]
+	static size_t chunk_end(const size_t i){
+		return (i | (COW_CHUNK - 1)) + 1;
+	}
+
+	void push_back(const T& value){
+		if(!(count & (COW_CHUNK - 1))){
+			chunks.push_back(make_shared<chunk>());
+			chunks.back()->reserve(COW_CHUNK);
+		}
+		writable(count >> COW_CHUNK_BITS).push_back(value);
+		++count;
+	}
+	void pop_back(){
+		resize(count - 1);
+	}
+	// make room for k <= COW_CHUNK elements in one chunk [filling up the last one with
+	// value if they do not fit in there]
+	void append_run(const size_t k, const T& value){
+		if((count & (COW_CHUNK - 1)) && ((count & (COW_CHUNK - 1)) + k > COW_CHUNK))
+			while(count & (COW_CHUNK - 1)) push_back(value);
+	}
+	void resize(const size_t n, const T& value = T()){
+		if(n < count){
+			chunks.resize((n + COW_CHUNK - 1) >> COW_CHUNK_BITS);
+			if(n & (COW_CHUNK - 1)) writable(n >> COW_CHUNK_BITS).resize(n & (COW_CHUNK - 1));
+			count = n;
+		} else while(count < n) push_back(value);
+	}
+	void assign(const size_t n, const T& value){
+		clear();
+		resize(n, value);
+	}
+	void clear(){
+		chunks.clear();
+		count = 0;
+	}
+	void swap(cow_array& other){
+		chunks.swap(other.chunks);
+		std::swap(count, other.count);
+	}
+	// number of chunks shared with other arrays
+	size_t shared_chunks() const{
+		size_t result = 0;
+		for(size_t c = 0; c < chunks.size(); ++c)
+			if(chunks[c].use_count() > 1) ++result;
+		return result;
+	}
+	size_t count_chunks() const { return chunks.size(); }
+	// bytes of the chunks [full ones, whether shared or not]
+	size_t memory() const { return chunks.size() * (COW_CHUNK * sizeof(T) + sizeof(shared_ptr<chunk>)); }
+};
+
+#endif
@@ -8,20 +8,13 @@
 #include "sudoku.h"
 #include "gen_rules.h"
 #include <iostream>
-#include <algorithm>
 
 bool extend(const uint x, const uint y, gen_sudoku* s){
 	bool applicable = false;
 	uint num_digits = s->getnum_digits();
 	
-	vtree_list* group;
-	vtree_list* group2;
-	vtree_list* isect;
-	
-	insert_iterator<vtree_list>* iter;
-					
 	// cannot apply to empty cell
-	if(!s->get_node(x,y)->get_content()) return false; 
+	if(!s->get_cell(x,y)->get_content()) return false; 
 
 	for(uint digit = 1; digit <= num_digits; digit++){
 		applicable = false;
@@ -30,26 +23,21 @@ bool extend(const uint x, const uint y, gen_sudoku* s){
 		// if this number is one, we got a link
 
 		for(uint j = 0; j < 3; j++){
-			group = s->getvgroup(x,y,j);
-			for(uint i = 0; i < 3; i++) if(i != j)
-				for(uint n = 0; n < num_digits; n++){
-					isect = new vtree_list();
-					iter = new insert_iterator<vtree_list>(*isect, isect->begin());
-						
-					group2 = s->getvgroup(x,y,i);
-					set_intersection(group->begin(), group->end(), 
-									 group2->begin(), group2->end(), *iter);
-					if(!isect->empty()){
-						delete iter;
-						iter = new insert_iterator<vtree_list>(*isect, isect->begin());
-						set_difference(group2->begin(), group2->end(),
-									   group->begin(), group->end(), *iter);
-					}
-					delete iter;
-					delete isect;
+			const group_view<gen_cell> group = s->group(x,y,j);
+			for(uint i = 0; i < 3; i++) if(i != j){
+				const group_view<gen_cell> group2 = s->group(x,y,i);
+				// the intersection of both groups is group2 without the cells outside of group
+				const group_view<gen_cell> outside = group2.minus(group);
+				uint isect = 0;
+				for(group_view<gen_cell>::iterator k = group2.begin(); k != group2.end(); ++k)
+					if(!outside.contains(*k)) ++isect;
+				if(isect){
+					uint possible = 0;
+					for(group_view<gen_cell>::iterator k = outside.begin(); k != outside.end(); ++k)
+						if(!(*k)->get_content() && !(*k)->get_node()->vitnesscount(digit)) ++possible;
+					dbgout << possible << " possibilities for " << digit << " outside of group " << j << endl;
 				}
-			
-			delete group;
+			}
 		}
 		if(applicable) break;
 	}
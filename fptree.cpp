@@ -3,220 +3,464 @@
  * lib to manage force-propagation-trees for sudoku solution
  * by M.Weller
  **************************************************/
+#include <algorithm>
+
 #include "fptree.h"
 #include "sudoku.h"
 #include "solv_rules.h"
 
-bool trigger_triggered(const fp_trigger* trigger, const uint level_bits){
-	if(level_allowed(trigger->level,level_bits)){
-		for(fp_node_set::iterator i = trigger->node_set->begin(); i != trigger->node_set->end(); i++)
-			if(!((*i)->is_triggered())) return false;
-		return true;
-	} else {
-		printf("disallowing level %x [levelbits %x]\n", trigger->level, level_bits);
-		return false;
+/***************** memory of the force propagation trees **********************/
+
+fp_arena::fp_arena():used(FP_ARENA_BLOCK),allocations(0),reused(0),big_bytes(0){
+}
+// the objects in the blocks are not destroyed one by one, all their memory
+// is in the blocks anyway
+fp_arena::~fp_arena(){
+	for(uint i = 0; i < blocks.size(); ++i)
+		delete[] blocks[i];
+	for(uint i = 0; i < big_blocks.size(); ++i)
+		delete[] big_blocks[i];
+}
+
+void* fp_arena::allocate(const size_t bytes){
+	const size_t grains = (bytes + FP_ARENA_GRAIN - 1) / FP_ARENA_GRAIN;
+	++allocations;
+	if((grains < free_lists.size()) && free_lists[grains]){
+		void* result = free_lists[grains];
+		free_lists[grains] = *(void**)result;
+		++reused;
+		return result;
+	}
+	const size_t size = grains * FP_ARENA_GRAIN;
+	// big requests [the arrays of the graph] get a block of their own
+	if(4 * size > FP_ARENA_BLOCK){
+		big_blocks.push_back(new byte[size]);
+		big_bytes += size;
+		return big_blocks.back();
+	}
+	if(used + size > FP_ARENA_BLOCK){
+		blocks.push_back(new byte[FP_ARENA_BLOCK]);
+		used = 0;
+	}
+	used += size;
+	return blocks.back() + used - size;
+}
+
+void fp_arena::release(void* p, const size_t bytes){
+	if(!p) return;
+	const size_t grains = (bytes + FP_ARENA_GRAIN - 1) / FP_ARENA_GRAIN;
+	// big blocks go back to the heap
+	if(4 * grains * FP_ARENA_GRAIN > FP_ARENA_BLOCK){
+		for(size_t i = big_blocks.size(); i--;)
+			if(big_blocks[i] == p){
+				delete[] big_blocks[i];
+				big_blocks[i] = big_blocks.back();
+				big_blocks.pop_back();
+				big_bytes -= grains * FP_ARENA_GRAIN;
+				return;
+			}
+		diewith("releasing a block that is not in the arena" << endl);
 	}
+	if(grains >= free_lists.size()) free_lists.resize(grains + 1, NULL);
+	*(void**)p = free_lists[grains];
+	free_lists[grains] = p;
 }
 
+size_t fp_arena::memory() const{
+	return blocks.size() * FP_ARENA_BLOCK + big_bytes;
+}
 
-fp_trigger::operator int() const{
-  int result = 0;
+/***************** force propagation graph **********************/
 
-  for(fp_node_set::const_iterator i = node_set->begin(); i != node_set->end(); ++i)
-    if(*i) result += (int)(**i);
+fp_adjacency::fp_adjacency(const uint num_literals):
+	offsets(num_literals + 1, 0),heads(num_literals, FP_NONE),tails(num_literals, FP_NONE){
+}
 
-  if(owner) result += (int)(*owner);
-  return result + level;
+void fp_adjacency::add(const uint literal, const uint trigger){
+	const overflow_edge edge = {trigger, FP_NONE, tails[literal]};
+	const uint n = overflow.size();
+	overflow.push_back(edge);
+	if(tails[literal] == FP_NONE) heads.write(literal) = n;
+		else overflow.write(tails[literal]).next = n;
+	tails.write(literal) = n;
 }
 
-/***************** force propagation trees **********************/
+// take back the last edge added [it must be the last one of literal]
+void fp_adjacency::undo_add(const uint literal){
+	const uint n = overflow.size() - 1;
+	if(tails[literal] != n) diewith("undoing an edge out of order" << endl);
+	const uint prev = overflow[n].prev;
+	if(prev == FP_NONE) heads.write(literal) = FP_NONE;
+		else overflow.write(prev).next = FP_NONE;
+	tails.write(literal) = prev;
+	overflow.pop_back();
+}
 
-// force propagation tree node: a cell and one of its 
-// possibilities/non-possibilities in a sudoku grid. 
-// basically a hypothesis of placing/not placing a digit there
-void fp_node::init(const fp_trigger_set* _triggers, const fp_impact_set* _impacts){
-		triggered = false;
-		if(_triggers) triggers = new fp_trigger_set(*_triggers);
-				else  triggers = new fp_trigger_set();
-		if(_impacts) impacts = new fp_impact_set(*_impacts);
-				else impacts = new fp_impact_set();
+void fp_adjacency::compact(const fp_vector<uint>& remap){
+	const uint num_literals = heads.size();
+	cow_array<uint> new_offsets(num_literals + 1, 0);
+	cow_array<uint> new_edges;
+	for(uint l = 0; l < num_literals; ++l){
+		any(l, [&](const uint t){
+			if(remap[t] != FP_NONE) new_edges.push_back(remap[t]);
+			return false;
+		});
+		new_offsets.write(l + 1) = new_edges.size();
 	}
+	offsets.swap(new_offsets);
+	edges.swap(new_edges);
+	heads.assign(num_literals, FP_NONE);
+	tails.assign(num_literals, FP_NONE);
+	overflow.clear();
+}
 
-// constructor
-fp_node::fp_node(solv_cell* _cell, const int _thesis):cell(_cell),thesis(_thesis){
-	init(NULL, NULL);
+size_t fp_adjacency::shared_chunks() const{
+	return offsets.shared_chunks() + edges.shared_chunks() + heads.shared_chunks() +
+		tails.shared_chunks() + overflow.shared_chunks();
 }
 
-// copy constructor
-fp_node::fp_node(const fp_node& fpnode):cell(fpnode.cell),thesis(fpnode.thesis){
-	init(fpnode.triggers, fpnode.impacts);
+size_t fp_adjacency::count_chunks() const{
+	return offsets.count_chunks() + edges.count_chunks() + heads.count_chunks() +
+		tails.count_chunks() + overflow.count_chunks();
 }
-	
-// destructor
-// 1. remove references to this node from all triggers
-// 2. free its memories
-fp_node::~fp_node(){
-//	printf("destroying %p (%d,%d,%d) [%d triggers, %d impacts]:\n", this, cell->get_x(), cell->get_y(), thesis, triggers->size(), impacts->size());
 
+size_t fp_adjacency::chunk_memory() const{
+	return offsets.memory() + edges.memory() + heads.memory() + tails.memory() + overflow.memory();
+}
 
-	// erase all nodes' impacts that would trigger any trigger of this thesis 
-	for(fp_trigger_set::iterator i = triggers->begin(); i != triggers->end(); i++)
-		if(!remove_trigger(*i))
-      diewith("something is fishy [triggers]..."<<endl);
 
-	// erase all nodes' triggers that this thesis has an impact on
-	// note: this removes whole triggers because if one node of a trigger is
-	// 		 impossible, the whole trigger is
-	for(fp_impact_set::iterator i = impacts->begin(); i != impacts->end();){
-	  fp_impact_p imp = *i;
-    ++i;
+fp_graph::fp_graph(const uint _num_digits, fp_arena* _arena):num_digits(_num_digits),
+	num_literals(2 * _num_digits * _num_digits * _num_digits),arena(_arena),
+	exists(num_literals, 0, fp_allocator<byte>(_arena)),owned(num_literals),impacts(num_literals),
+	dead(0),propagating(false),scratch(fp_allocator<uint>(_arena)),worklist(fp_allocator<uint>(_arena)),
+	marks(fp_allocator<size_t>(_arena)),trail(fp_allocator<fp_trail_entry>(_arena)),watching(false),changes(fp_allocator<uint>(_arena)){
+	nodes = (fp_node*)arena->allocate(num_literals * sizeof(fp_node));
+}
 
-		if(!imp->owner->remove_trigger(imp))
-      diewith("something is fishy [impacts]..."<<endl);
+// the tables are shared until written, only the nodes and the per-literal
+// flags are copied
+fp_graph::fp_graph(const fp_graph& other, fp_arena* _arena):num_digits(other.num_digits),
+	num_literals(other.num_literals),arena(_arena),
+	exists(other.exists.begin(), other.exists.end(), fp_allocator<byte>(_arena)),
+	triggers(other.triggers),antecedents(other.antecedents),owned(other.owned),impacts(other.impacts),
+	dead(other.dead),propagating(false),scratch(fp_allocator<uint>(_arena)),worklist(fp_allocator<uint>(_arena)),
+	marks(fp_allocator<size_t>(_arena)),trail(fp_allocator<fp_trail_entry>(_arena)),watching(false),changes(fp_allocator<uint>(_arena)){
+	if(other.propagating) diewith("copying a graph while it fires" << endl);
+	nodes = (fp_node*)arena->allocate(num_literals * sizeof(fp_node));
+}
 
-		delete imp->node_set;
-		delete imp;
-	}
+fp_node* fp_graph::node(const uint literal) const{
+	return nodes + literal;
+}
 
-	delete triggers;
-	delete impacts;
+fp_node* fp_graph::create_node(solv_cell* cell, const int thesis){
+	const uint literal = fp_literal(cell->get_index(), thesis, num_digits);
+	exists[literal] = 1;
+	return new(nodes + literal) fp_node(this, cell, thesis, literal);
 }
 
-int fp_node::get_thesis() const{
-	return thesis;
+fp_node* fp_graph::clone_node(solv_cell* cell, const fp_node& model){
+	fp_node* result = new(nodes + model.literal) fp_node(this, cell, model.thesis, model.literal);
+	result->triggered = model.triggered;
+	return result;
 }
-bool fp_node::is_triggered() const{
-	return triggered;
+
+size_t fp_graph::shared_chunks() const{
+	return triggers.shared_chunks() + antecedents.shared_chunks() + owned.shared_chunks() + impacts.shared_chunks();
+}
+
+size_t fp_graph::count_chunks() const{
+	return triggers.count_chunks() + antecedents.count_chunks() + owned.count_chunks() + impacts.count_chunks();
+}
+
+size_t fp_graph::chunk_memory() const{
+	return triggers.memory() + antecedents.memory() + owned.chunk_memory() + impacts.chunk_memory();
 }
 
-// add a trigger to the trigger set and return it
-// return a pointer to the trigger who contains
-// the given fp_node_set
-fp_trigger_p fp_node::add_trigger(
-                          fp_node_set* nodes,
-                          const uint level,
-                          const uint level_bits){
-	if(!nodes) return false;
+// let the given antecedents trigger owner, return whether it is a new
+// trigger or triggered owner right away
+bool fp_graph::add_trigger(fp_node* owner, const fp_node_list& nodes, const uint level, const uint level_bits){
 	// dont add triggers to a triggered node
-	if(triggered) return false;
-	// check if the trigger is triggerable [whether it contains NULL]
-	if(nodes->find(NULL) != nodes->end()) {
-		delete nodes;
-    nodes = NULL;
-		return NULL;
+	if(owner->is_triggered()) return false;
+	// the trigger can never fire if one of its nodes is gone [the rules may
+	// hold on to nodes that got removed while they added other triggers]
+	scratch.clear();
+	for(fp_node_list::const_iterator i = nodes.begin(); i != nodes.end(); ++i){
+		if(!*i || !exists[(*i)->literal]) return false;
+		if(!(*i)->is_triggered()) scratch.push_back((*i)->literal);
 	}
-  dbgout << "nodes are " << *nodes << endl;
-  // remove all triggered nodes
-	for(fp_node_set::iterator i = nodes->begin(); i != nodes->end();)
-		if(*i){
-      if((*i)->is_triggered()){
-        fp_node_set::iterator j = i++;
-        nodes->erase(j);
-      } else ++i;
-    }
-
-	fp_trigger* tr = new fp_trigger(nodes, this, level);
-
-  // if the node set is empty (the empty set triggers *this), then trigger *this
-  if(nodes->empty()) {
-    dbgout << "got empty trigger set, triggering " << *this << endl;
-    set_trigger(level_bits);
-    return tr;
-  }
+	// the triggers must not move while fire() works on them or the trail
+	// refers to them
+	const size_t overflow = owned.overflow_size() + impacts.overflow_size();
+	if(!propagating && marks.empty() && (overflow > FP_COMPACT_MIN) && (2 * overflow > owned.size() + impacts.size()))
+		compact();
+	return insert(owner->literal, level, level_bits);
+}
+
+// add a trigger [antecedents in scratch, none triggered or removed]
+bool fp_graph::insert(const uint owner, const uint level, const uint level_bits){
+	sort(scratch.begin(), scratch.end());
+	scratch.erase(unique(scratch.begin(), scratch.end()), scratch.end());
+
+	// if the node set is empty (the empty set triggers owner), then trigger owner
+	if(scratch.empty()){
+		dbgout << "got empty trigger set, triggering " << nodes[owner] << endl;
+		nodes[owner].set_trigger(level_bits);
+		return true;
+	}
+
+	// the trigger is in the list already [up to the antecedents triggered since]
+	const bool known = owned.any(owner, [&](const uint t){
+		const fp_trigger& tr = triggers[t];
+		if(!tr.alive || (tr.level != level) || (tr.unsatisfied != scratch.size())) return false;
+		uint matched = 0;
+		for(const uint* i = trigger_begin(t); i != trigger_end(t); ++i)
+			if(!nodes[*i].triggered && (scratch[matched++] != *i)) return false;
+		return true;
+	});
+	if(known) return false;
+
+	const uint t = triggers.size();
+	antecedents.append_run(scratch.size(), FP_NONE);
+	const fp_trigger tr = {owner, level, (uint)antecedents.size(), (uint)scratch.size(), (uint)scratch.size(), true};
+	triggers.push_back(tr);
+	for(uint i = 0; i < scratch.size(); ++i)
+		antecedents.push_back(scratch[i]);
+	owned.add(owner, t);
+	// add symmetric impacts
+	for(uint i = 0; i < scratch.size(); ++i)
+		impacts.add(scratch[i], t);
+	log(FP_TRAIL_INSERT, t);
+	if(DEBUG){
+		cout << "adding trigger ";
+		print_trigger(cout, t);
+		cout << endl;
+	}
+	return true;
+}
+
+void fp_graph::kill(const uint trigger){
+	if(!triggers[trigger].alive) return;
+	triggers.write(trigger).alive = false;
+	++dead;
+	log(FP_TRAIL_KILL, trigger);
+}
+
+// the thesis holds: fire it and everything that follows [if called
+// while firing, node just joins the worklist]
+void fp_graph::fire(fp_node* node, const uint level_bits){
+	worklist.push_back(node->literal);
+	if(propagating) return;
+	propagating = true;
+	for(size_t next = 0; next < worklist.size(); ++next){
+		fp_node& n = nodes[worklist[next]];
+		if(n.triggered) continue;
+		if(!exists[n.literal]) invalidwith("sudoku is invalid: triggering removed thesis " << n);
+		log(FP_TRAIL_FIRE, n.literal);
+		n.mark(level_bits);
+
+		// count down the triggers it is in
+		impacts.any(n.literal, [&](const uint t){
+			if(!triggers[t].alive) return false;
+			fp_trigger& tr = triggers.write(t);
+			log(FP_TRAIL_COUNT, t);
+			if(!--tr.unsatisfied){
+				kill(t);
+				worklist.push_back(tr.owner);
+			} else if(nodes[tr.owner].triggered) kill(t);
+			return false;
+		});
+		// its own triggers are of no use any more
+		owned.any(n.literal, [&](const uint t){
+			kill(t);
+			return false;
+		});
+	}
+	worklist.clear();
+	propagating = false;
+}
 
-	pair<fp_trigger_set::iterator, bool> result = triggers->insert(tr);
-  
-	if(!result.second) {
-		// the trigger is in the list already
-		delete tr;
-		dbgout << "trigger exists: " << **(result.first) << endl;
+// the thesis cannot hold: drop the node and all triggers it is in
+void fp_graph::remove(fp_node* node){
+	exists[node->literal] = 0;
+	log(FP_TRAIL_REMOVE, node->literal);
+	// this removes whole triggers because if one node of a trigger is
+	// impossible, the whole trigger is
+	impacts.any(node->literal, [&](const uint t){
+		kill(t);
+		return false;
+	});
+	owned.any(node->literal, [&](const uint t){
+		kill(t);
+		return false;
+	});
+}
 
-//		return *(result.first);
-    return NULL;
-	} else {
-    dbgout << "adding trigger " << *tr <<  " to thesis " << *this << endl;
+// throw out the dead triggers, renumber the others and rebuild the adjacency
+void fp_graph::compact(){
+	fp_vector<uint> remap(triggers.size(), FP_NONE, scratch.get_allocator());
+	cow_array<fp_trigger> new_triggers;
+	cow_array<uint> new_antecedents;
+	for(uint t = 0; t < triggers.size(); ++t)
+		if(triggers[t].alive){
+			remap[t] = new_triggers.size();
+			new_antecedents.append_run(triggers[t].count, FP_NONE);
+			new_triggers.push_back(triggers[t]);
+			new_triggers.write(remap[t]).first = new_antecedents.size();
+			for(const uint* i = trigger_begin(t); i != trigger_end(t); ++i)
+				new_antecedents.push_back(*i);
+		}
+	triggers.swap(new_triggers);
+	antecedents.swap(new_antecedents);
+	owned.compact(remap);
+	impacts.compact(remap);
+	dead = 0;
+}
 
-		// add symmectric impacts
-		for(fp_node_set::iterator i = nodes->begin(); i != nodes->end(); ++i)
-			(*i)->add_impact(tr, level);
+// start recording changes, return the mark to roll back to
+size_t fp_graph::checkpoint(){
+	const size_t mark = trail.size();
+	marks.push_back(mark);
+	log(FP_TRAIL_MARK, 0);
+	return mark;
+}
 
-    dbgout << "done adding trigger" << endl;
-		return tr;
+// undo all changes since the checkpoint of mark and close it
+void fp_graph::rollback(const size_t mark){
+	if(marks.empty() || (mark != marks.back())) diewith("rolling back to a checkpoint that is not the innermost open one" << endl);
+	while(trail.size() > mark){
+		undo(trail.back());
+		trail.pop_back();
 	}
+	commit(mark);
+}
+
+// keep the changes since the checkpoint of mark and close it
+void fp_graph::commit(const size_t mark){
+	if(marks.empty() || (mark != marks.back())) diewith("closing a checkpoint that is not the innermost open one" << endl);
+	marks.pop_back();
+	// the outermost checkpoint is gone, nothing can go back any more
+	if(marks.empty()) trail.clear();
+}
+
+void fp_graph::undo(const fp_trail_entry& entry){
+	switch(entry.kind){
+		case FP_TRAIL_FIRE:
+			nodes[entry.what].unmark();
+			break;
+		case FP_TRAIL_REMOVE:
+			exists[entry.what] = 1;
+			nodes[entry.what].cell->restore_thesis(&nodes[entry.what]);
+			break;
+		case FP_TRAIL_INSERT:{
+			const fp_trigger& tr = triggers[entry.what];
+			if(entry.what != triggers.size() - 1) diewith("undoing a trigger out of order" << endl);
+			for(uint i = tr.count; i--;)
+				impacts.undo_add(antecedents[tr.first + i]);
+			owned.undo_add(tr.owner);
+			antecedents.resize(tr.first);
+			triggers.pop_back();
+			break;
+		}
+		case FP_TRAIL_KILL:
+			triggers.write(entry.what).alive = true;
+			--dead;
+			break;
+		case FP_TRAIL_COUNT:
+			++triggers.write(entry.what).unsatisfied;
+			break;
+		case FP_TRAIL_MARK:
+			break;
+	}
+}
+
+void fp_graph::print_trigger(ostream& os, const uint t) const{
+	const fp_trigger& tr = triggers[t];
+	if(level_allowed(tr.level, LVL_FLOOD))     os << "F ";
+	if(level_allowed(tr.level, LVL_ELIMINATE)) os << "E ";
+	if(level_allowed(tr.level, LVL_LOCATE))    os << "L ";
+	if(level_allowed(tr.level, LVL_GROUP))     os << "G ";
+
+  os << "(" << t << ")" << "{";
+  for(const uint* i = trigger_begin(t); i != trigger_end(t); ++i)
+    os << nodes[*i] << " ";
+  os << "} --> " << nodes[tr.owner];
+}
+
+
+/***************** force propagation trees **********************/
+
+// force propagation tree node: a cell and one of its 
+// possibilities/non-possibilities in a sudoku grid. 
+// basically a hypothesis of placing/not placing a digit there
+fp_node::fp_node(fp_graph* _graph, solv_cell* _cell, const int _thesis, const uint _literal):
+	graph(_graph),cell(_cell),thesis(_thesis),literal(_literal),triggered(false){
+}
+
+int fp_node::get_thesis() const{
+	return thesis;
+}
+uint fp_node::get_literal() const{
+	return literal;
+}
+bool fp_node::is_triggered() const{
+	return triggered;
+}
+solv_cell* fp_node::get_cell() const{
+	return cell;
+}
+fp_graph* fp_node::get_graph() const{
+	return graph;
 }
 
+// add a trigger made of the given nodes, return whether it is new or
+// triggered *this right away
+bool fp_node::add_trigger(const fp_node_list& nodes, const uint level, const uint level_bits){
+  dbgout << "nodes are " << nodes << endl;
+	return graph->add_trigger(this, nodes, level, level_bits);
+}
 
 // add a single fp_node to the trigger set
-fp_trigger_p fp_node::add_trigger(fp_node* _tr_node,
+bool fp_node::add_trigger(fp_node* _tr_node,
                                   const uint level,
                                   const uint level_bits){
-	if(!_tr_node) return NULL;
+	if(!_tr_node) return false;
 
   dbgout << "adding single trigger " << *_tr_node << " to " << *this << endl;
 
-	fp_node_set* node_set = new fp_node_set();
-	node_set->insert(_tr_node);
-		
-	return add_trigger(node_set, level, level_bits);
+	const fp_node_list nodes(1, _tr_node);
+	return graph->add_trigger(this, nodes, level, level_bits);
 }
 
 
 // convinience function for adding a triggers-impact relationship
 // if "tr_digit" is confirmed for all cells in "tr_cells", then trigger *this
 bool fp_node::add_triggers(
-                    solv_set* tr_cells, 
+                    const group_view<solv_cell>& tr_cells, 
                     const int tr_digit, 
                     const uint level, 
                     const uint level_bits){
 
-	fp_node_set* fp_group = new fp_node_set();
-  
-	for(solv_set::iterator i = tr_cells->begin(); i != tr_cells->end(); i++){
+	fp_node_list fp_group;
+	fp_group.reserve(tr_cells.size());
+	for(group_view<solv_cell>::iterator i = tr_cells.begin(); i != tr_cells.end(); ++i){
     const solv_cell& cell = **i;
-		fp_group->insert(cell[tr_digit]);
+		fp_group.push_back(cell[tr_digit]);
   }
-	return add_trigger(fp_group, level, level_bits);
-}
-
-
-// remove a trigger and all its references from the node
-bool fp_node::remove_trigger(const fp_trigger* _trigger){
-	if(triggers->find(_trigger) == triggers->end())
-		diewith("trigger " << *_trigger << " is not in the trigger-list: " << *triggers << endl);
-
- // remove all impacts pointing to _trigger
-  for(fp_node_set::iterator i = _trigger->node_set->begin(); i != _trigger->node_set->end(); ++i)
-    if(!(*i)->remove_impact(_trigger))
-      diewith("it appears " << **i << " doesn't trigger " << *_trigger << " after all...");
-
-  //dbgout << "removing "<< *_trigger << " from " << *this << " as requested" << endl;
-#warning fixme: this is a memory leak since I forget the pointer to the trigger and can no longer free it
-  return triggers->erase(_trigger);
-} 
-
-// add an impact to the impact set
-bool fp_node::add_impact(fp_trigger_p impact, const uint level){
-//	pair<fp_trigger_set::iterator, bool> result = impacts->insert(impact);
-  return (impacts->insert(impact)).second;
-}
-// remove an impact and all its references from the node
-bool fp_node::remove_impact(fp_trigger_p _impact){
-	return (impacts->erase(_impact) > 0);
-}
-
-solv_cell* fp_node::get_cell() const{
-	return cell;
+	return graph->add_trigger(this, fp_group, level, level_bits);
 }
 
 
-// (
-int indent = 0;
 void fp_node::set_trigger(const uint level_bits){
 	if(triggered) return;
 	if(!thesis) diewith("triggering 'invalid_sudoku'"<<endl);
+	graph->fire(this, level_bits);
+}
 
+// the effects of firing on the cell: drop the opposite, fill in the digit
+void fp_node::mark(const uint level_bits){
   if(thesis > 0) cout << "found that " << *this << endl;
-	dbgout << indent++ << ": triggering " << *this << endl;
+	dbgout << "triggering " << *this << endl;
 
 	triggered = true;
 
@@ -224,30 +468,36 @@ void fp_node::set_trigger(const uint level_bits){
 	cell->remove_thesis(-thesis, level_bits);
 
 	if(thesis > 0) cell->set_content(thesis, level_bits);
+}
 
-  // remove this from the triggers of all its impacts
-  while(!impacts->empty()){
-    fp_impact_p imp = *(impacts->begin());
-    fp_node* node = imp->owner;
- 
-    // we have to remove and readd the triggers because their hash-value changes
-    // when re-adding the triggers, this will be removed automatically since it's triggered
-    dbgout << "fixing trigger " << *imp << endl;
-    node->remove_trigger(imp);
-    node->add_trigger(imp->node_set, imp->level, level_bits);
-  }
+// take back mark() [the opposite comes back on its own trail entry]
+void fp_node::unmark(){
+	triggered = false;
+	if(thesis > 0) cell->restore_content(0);
+}
 
-  // next, remove all its triggers
-  while(!triggers->empty()){
-    fp_trigger_p tr = *(triggers->begin());
-    fp_node* node = tr->owner;
-    node->remove_trigger(tr);
-  }
 
-	indent--;
-	dbgout << indent << ": done triggering" << endl;
+fp_search::fp_search(const fp_graph* _graph):graph(_graph),stamps(_graph->getnum_literals(), 0),epoch(0){
 }
 
+// a new epoch forgets all visits [starting over when the counter wraps]
+void fp_search::next_epoch(){
+	if(!++epoch){
+		stamps.assign(stamps.size(), 0);
+		epoch = 1;
+	}
+	stack.clear();
+}
+
+// visit literal and push it, return true if its opposite was visited
+bool fp_search::enter(const uint literal){
+	dbgout << stack.size() << ":\tfinding path from" << *graph->node(literal) << endl;
+	if(graph->has_node(literal ^ 1) && visited(literal ^ 1)) return true;
+	stamps[literal] = epoch;
+	const frame f = {literal, graph->get_impacts().first(literal)};
+	stack.push_back(f);
+	return false;
+}
 
 // returns if from can reach 'to' with a slihtly modified DFS
 // restricted means:
@@ -256,115 +506,351 @@ void fp_node::set_trigger(const uint level_bits){
 // (in other words its a cycle in the bigraph [for use with bi_graph]
 // to trace non-extended rules [without Gx], forbit to follow LVL_FLOOD rules,
 // except if both end-nodes have less then 3 possible numbers
-set<const fp_node*> visited;
-bool fp_gap(const fp_node* from, const fp_node* to, const uint level_bits, const uint restrict_level, const uint level){
+// [the nodes seen stay visited when the search backs up, so a trigger is
+// followed once all its antecedents were seen anywhere before]
+bool fp_search::gap(const fp_node* from, const fp_node* to, const uint level_bits, const uint restrict_level){
 	if(!from || !to) return false;
-	dbgout << level << ":\tfinding path from" << *from << " to " << *to << endl;
-	if((from == to) || (to->is_triggered())) {
-		visited.clear();
-		return true;
-	} else {
-		bool is_marked;
-		fp_node* opp = (*from->get_cell())[-from->get_thesis()];
-		if(opp)	if(visited.find(opp) != visited.end()) {
-				visited.clear();
-				return true;
+	if((from == to) || (to->is_triggered())) return true;
+	next_epoch();
+	if(enter(from->get_literal())) return true;
+
+	const fp_adjacency& impacts = graph->get_impacts();
+	while(!stack.empty()){
+		uint t;
+		if(!impacts.next(stack.back().next, t)){
+			stack.pop_back();
+			continue;
+		}
+		const fp_trigger& tr = graph->trigger(t);
+		// only consider live triggers of appropriate level
+		if(!tr.alive || !level_allowed(tr.level, level_bits)) continue;
+		const fp_node* owner = graph->node(tr.owner);
+		// if the node to be triggered is already visited, just continue the loop
+		if(visited(tr.owner)) continue;
+		// if any of the nodes of the trigger was not visited or triggered, continue loop
+		// this makes sure each trigger is only taken into account if all its nodes 
+		// are found to be impacts of the node we started the search from
+		bool is_marked = true;
+		if(!owner->is_triggered()){
+			uint count_untrigg = 0;
+			const fp_node* the_untrig = NULL;
+			for(const uint* j = graph->trigger_begin(t); j != graph->trigger_end(t); ++j){
+				const fp_node* node = graph->node(*j);
+				if(!node->is_triggered()) {
+					count_untrigg++;
+					the_untrig = node;
+					is_marked &= visited(*j);
+				}
 			}
-		visited.insert(from);
-		for(fp_impact_set::iterator i = from->impacts->begin(); i != from->impacts->end(); i++)
-			// only consider triggers of appropriate level
-			if(level_allowed((*i)->level, level_bits)){
-				// if the node to be triggered is already visited, just continue the loop
-				if(visited.find((*i)->owner) == visited.end()) {
-					// if any of the nodes of i was not visited or triggered, continue loop
-					// this makes sure each trigger is only taken into account if all its nodes 
-					// are found to be impacts of the node we started the search from
-					is_marked = true;
-					if(!(*i)->owner->is_triggered()){
-						uint count_untrigg = 0;
-						fp_node* the_untrig = NULL;
-						for(fp_node_set::iterator j = (*i)->node_set->begin(); j != (*i)->node_set->end(); j++)
-							if(!((*j)->is_triggered())) {
-								count_untrigg++;
-								the_untrig = *j;
-								is_marked &= ((visited.find(*j)) != visited.end());
-							}
-
-						// restriction implementation [for use with bi_graphs]
-						if(restrict_level && is_marked){
-							printf("restricted gap: branching okay: %s\n", is_marked?"yes":"no");
-							if((count_untrigg > 1)) is_marked = false;
-							else{ // if the restriction level is < 2, forbid group_flood rules
-								if((restrict_level < 2) && ((*i)->level & LVL_FLOOD) > 0) {
-									if(the_untrig) {
-										if((the_untrig->get_cell()->count_poss() > 2) || 
-											((*i)->owner->get_cell()->count_poss() > 2)) // unless it is bivalued
-											is_marked = false;
-//										printf("okay to branch: %s, posses: %i, %i\n", is_marked?"yes":"no",the_untrig->get_cell()->count_poss(), (*i)->owner->get_cell()->count_poss());
-									} else {printf("uh oh, panic!\n");exit(1);}
-                }
-              }
-						}			
-					}
-					// if all nodes of the trigger are visited or triggered, it is an impact of the node
-					// we started searching from, so continue search from there
-					if(is_marked){
-						dbgout << "branching: " << **i << endl;
-						if(fp_gap((*i)->owner, to, level_bits, restrict_level, level + 1)) return true;
+
+			// restriction implementation [for use with bi_graphs]
+			if(restrict_level && is_marked){
+				dbgprint("restricted gap: branching okay: %s\n", is_marked?"yes":"no");
+				if((count_untrigg > 1)) is_marked = false;
+				else{ // if the restriction level is < 2, forbid group_flood rules
+					if((restrict_level < 2) && (tr.level & LVL_FLOOD) > 0) {
+						if(the_untrig) {
+							if((the_untrig->get_cell()->count_poss() > 2) || 
+								(owner->get_cell()->count_poss() > 2)) // unless it is bivalued
+								is_marked = false;
+						} else diewith("restricted gap: no untriggered node in a trigger of an untriggered node" << endl);
 					}
 				}
 			}
-		if(!level) visited.clear();
+		}
+		// if all nodes of the trigger are visited or triggered, it is an impact of the node
+		// we started searching from, so continue search from there
+		if(is_marked){
+			if(DEBUG){
+				cout << "branching: ";
+				graph->print_trigger(cout, t);
+				cout << endl;
+			}
+			if((owner == to) || enter(tr.owner)) return true;
+		}
+	}
+	return false;
+}
+
+// literal i of a set is bit i % 64 of word i / 64
+#define FP_BIT(literal) ((uint64_t)1 << ((literal) & 63))
+// the set with each literal swapped for its opposite [neighbouring bits]
+inline uint64_t fp_opposites(const uint64_t bits){
+	return ((bits & 0x5555555555555555ull) << 1) | ((bits >> 1) & 0x5555555555555555ull);
+}
+
+// whether trigger t fires once seen holds [as in gap(), a trigger of a
+// triggered owner always does]
+bool fp_search::complete(const uint t) const{
+	const fp_trigger& tr = graph->trigger(t);
+	if(triggered[tr.owner >> 6] & FP_BIT(tr.owner)) return true;
+	for(const uint* j = graph->trigger_begin(t); j != graph->trigger_end(t); ++j)
+		if(!((triggered[*j >> 6] | seen[*j >> 6]) & FP_BIT(*j))) return false;
+	return true;
+}
+
+// add literal to the search, return true on a contradiction
+bool fp_search::reach(const uint c, const uint literal){
+	if(seen[(literal ^ 1) >> 6] & FP_BIT(literal ^ 1)) return true;
+	seen[literal >> 6] |= FP_BIT(literal);
+	const uint d = component[literal];
+	// theses of c and of components not done yet are expanded one by one
+	if((d == FP_NONE) || (d == c)){
+		todo.push_back(literal);
 		return false;
 	}
+	if(bad[d]) return true;
+	// everything following from d follows from here
+	const uint64_t* closure = &closures[(size_t)d * words];
+	for(uint w = 0; w < words; ++w)
+		if(closure[w] & fp_opposites(seen[w])) return true;
+	for(uint w = 0; w < words; ++w)
+		seen[w] |= closure[w];
+	recheck.insert(recheck.end(), waiting.begin() + waiting_first[d], waiting.begin() + waiting_first[d + 1]);
+	return false;
 }
 
-ostream& operator<<(ostream& os, const fp_node& n){
-  return os << (n.triggered?"*":"") << *(n.cell) << "=" << n.thesis;
+// whether the theses following from literal [of component c] hold a thesis
+// and its opposite [or a thesis of a bad component]; the theses seen are
+// the same as those of gap(), as a trigger is followed once all its
+// untriggered antecedents were seen, whatever the order
+bool fp_search::contradicts(const uint c, const uint literal, const uint level_bits){
+	const fp_adjacency& impacts = graph->get_impacts();
+	const size_t first = waiting.size();
+	seen.assign(words, 0);
+	todo.clear();
+	recheck.clear();
+	if(reach(c, literal)) return true;
+	while(!todo.empty() || !recheck.empty()){
+		// triggers of components taken over may fire with what is seen now
+		if(!recheck.empty()){
+			const uint t = recheck.back();
+			recheck.pop_back();
+			const uint owner = graph->trigger(t).owner;
+			if(seen[owner >> 6] & FP_BIT(owner)) continue;
+			if(!complete(t)) waiting.push_back(t);
+			else if(reach(c, owner)) return true;
+			continue;
+		}
+		const uint l = todo.back();
+		todo.pop_back();
+		fp_adjacency::cursor next = impacts.first(l);
+		uint t;
+		while(impacts.next(next, t)){
+			const fp_trigger& tr = graph->trigger(t);
+			if(!tr.alive || !level_allowed(tr.level, level_bits) || (seen[tr.owner >> 6] & FP_BIT(tr.owner))) continue;
+			if(!complete(t)) waiting.push_back(t);
+			else if(reach(c, tr.owner)) return true;
+		}
+	}
+	// keep what follows from c and the triggers still missing antecedents
+	closures.insert(closures.end(), seen.begin(), seen.end());
+	uint kept = first;
+	for(size_t i = first; i < waiting.size(); ++i){
+		const uint owner = graph->trigger(waiting[i]).owner;
+		if(!(seen[owner >> 6] & FP_BIT(owner))) waiting[kept++] = waiting[i];
+	}
+	waiting.resize(kept);
+	sort(waiting.begin() + first, waiting.end());
+	waiting.erase(unique(waiting.begin() + first, waiting.end()), waiting.end());
+	return false;
 }
 
-ostream& operator<<(ostream& os, const fp_node_set& s){
-  os << "{";
-  for(fp_node_set::const_iterator i = s.begin(); i != s.end(); ++i){
-    if(*i) os << **i << " "; else os << "NULL ";
-  }
-  return os << "}";
+// the next trigger of literal that is a plain implication, FP_NONE at the end
+uint fp_search::next_implication(fp_adjacency::cursor& c, const uint level_bits) const{
+	uint t;
+	while(graph->get_impacts().next(c, t)){
+		const fp_trigger& tr = graph->trigger(t);
+		// literal is untriggered, so it is the only antecedent left
+		if(tr.alive && (tr.unsatisfied == 1) && level_allowed(tr.level, level_bits) &&
+			!graph->node(tr.owner)->is_triggered()) return t;
+	}
+	return FP_NONE;
 }
 
-ostream& operator<<(ostream& os, const solv_set& s){
-  os << "{";
-  for(solv_set::const_iterator i = s.begin(); i != s.end(); ++i){
-    if(*i) os << **i << " "; else os << "NULL ";
-  }
-  return os << "}";
+// Tarjan's algorithm from literal, with the recursion on calls; a
+// component is judged as soon as it is complete [those it implies are done]
+void fp_search::strongconnect(const uint literal, const uint level_bits, uint& count){
+	index[literal] = low[literal] = count++;
+	members.push_back(literal);
+	const frame root = {literal, graph->get_impacts().first(literal)};
+	calls.push_back(root);
+	while(!calls.empty()){
+		const uint v = calls.back().literal;
+		const uint t = next_implication(calls.back().next, level_bits);
+		if(t != FP_NONE){
+			const uint w = graph->trigger(t).owner;
+			if(index[w] == FP_NONE){
+				index[w] = low[w] = count++;
+				members.push_back(w);
+				const frame f = {w, graph->get_impacts().first(w)};
+				calls.push_back(f);
+			} else if(component[w] == FP_NONE) low[v] = min(low[v], index[w]);
+			continue;
+		}
+		calls.pop_back();
+		if(!calls.empty()) low[calls.back().literal] = min(low[calls.back().literal], low[v]);
+		if(low[v] != index[v]) continue;
+		// v is the root of a component: take it off the stack
+		const uint c = bad.size();
+		bad.push_back(0);
+		uint m;
+		do{
+			m = members.back();
+			members.pop_back();
+			component[m] = c;
+			if(component[m ^ 1] == c) bad[c] = 1;
+		} while(m != v);
+		const size_t first = waiting.size();
+		if(!bad[c]) bad[c] = contradicts(c, v, level_bits);
+		// a bad component needs no closure [nothing takes it over]
+		if(bad[c]){
+			closures.resize(bad.size() * words, 0);
+			waiting.resize(first);
+		}
+		waiting_first.push_back(waiting.size());
+	}
 }
 
-ostream& operator<<(ostream& os, const fp_trigger& t){
-	if(level_allowed(t.level, LVL_FLOOD))     os << "F ";
-	if(level_allowed(t.level, LVL_ELIMINATE)) os << "E ";
-	if(level_allowed(t.level, LVL_LOCATE))    os << "L ";
-	if(level_allowed(t.level, LVL_GROUP))     os << "G ";
+// all untriggered theses that reach their opposite [or a thesis and its
+// opposite] over triggers of level_bits
+void fp_search::contradictions(const uint level_bits, vector<uint>& literals){
+	const uint num_literals = graph->getnum_literals();
+	index.assign(num_literals, FP_NONE);
+	low.assign(num_literals, 0);
+	component.assign(num_literals, FP_NONE);
+	bad.clear();
+	words = (num_literals + 63) / 64;
+	closures.clear();
+	waiting.clear();
+	waiting_first.assign(1, 0);
+	triggered.assign(words, 0);
+	for(uint l = 0; l < num_literals; ++l)
+		if(graph->has_node(l) && graph->node(l)->is_triggered()) triggered[l >> 6] |= FP_BIT(l);
+	uint count = 0;
+	for(uint l = 0; l < num_literals; ++l)
+		if(graph->has_node(l) && !graph->node(l)->is_triggered() && (index[l] == FP_NONE))
+			strongconnect(l, level_bits, count);
+	literals.clear();
+	for(uint l = 0; l < num_literals; ++l)
+		if((component[l] != FP_NONE) && bad[component[l]]) literals.push_back(l);
+}
 
-  trigger_hash ha;
-  os << "(" << ha(&t) << ")";
+fp_sweep::fp_sweep(const fp_graph* _graph):graph(_graph),queued(_graph->getnum_literals(), 0){
+}
 
-  return os << *t.node_set <<" --> " << *t.owner;
+// the sources trigger t passes on [reached from literal from], into lanes
+bool fp_sweep::passes(const uint t, const uint from, const uint level_bits, const uint restrict_level, uint64_t* lanes) const{
+	const fp_trigger& tr = graph->trigger(t);
+	if(!tr.alive || !level_allowed(tr.level, level_bits)) return false;
+	const uint64_t* from_lanes = &reach[(size_t)from * FP_SWEEP_WORDS];
+	// a triggered owner follows from any antecedent
+	if(triggered[tr.owner]){
+		memcpy(lanes, from_lanes, FP_SWEEP_WORDS * sizeof(uint64_t));
+		return true;
+	}
+	// restricted: a single untriggered antecedent, and no LVL_FLOOD rules
+	// below level 2 unless both ends are bivalued
+	if(restrict_level){
+		if(tr.unsatisfied > 1) return false;
+		uint the_untrig = from;
+		if(triggered[from])
+			for(const uint* j = graph->trigger_begin(t); j != graph->trigger_end(t); ++j)
+				if(!triggered[*j]) the_untrig = *j;
+		if((restrict_level < 2) && (tr.level & LVL_FLOOD))
+			if((graph->node(the_untrig)->get_cell()->count_poss() > 2) ||
+				(graph->node(tr.owner)->get_cell()->count_poss() > 2)) return false;
+		memcpy(lanes, &reach[(size_t)the_untrig * FP_SWEEP_WORDS], FP_SWEEP_WORDS * sizeof(uint64_t));
+		return true;
+	}
+	for(uint w = 0; w < FP_SWEEP_WORDS; ++w) lanes[w] = triggered[from] ? ~(uint64_t)0 : from_lanes[w];
+	for(const uint* j = graph->trigger_begin(t); j != graph->trigger_end(t); ++j)
+		if(!triggered[*j] && (*j != from))
+			for(uint w = 0; w < FP_SWEEP_WORDS; ++w) lanes[w] &= reach[(size_t)*j * FP_SWEEP_WORDS + w];
+	return true;
 }
 
-ostream& operator<<(ostream& os, const fp_trigger_set& s){
-  fp_trigger_set::hasher ha = s.hash_function();
+// the sources leading to a contradiction, as bits of result
+void fp_sweep::run(const uint* sources, const uint count, const uint level_bits, const uint restrict_level, uint64_t* result){
+	const uint num_literals = graph->getnum_literals();
+	reach.assign((size_t)num_literals * FP_SWEEP_WORDS, 0);
+	triggered.resize(num_literals);
+	for(uint l = 0; l < num_literals; ++l)
+		triggered[l] = graph->has_node(l) && graph->node(l)->is_triggered();
+	queue.clear();
+	for(uint i = 0; i < count; ++i){
+		reach[(size_t)sources[i] * FP_SWEEP_WORDS + i / 64] |= (uint64_t)1 << (i & 63);
+		if(!queued[sources[i]]){
+			queued[sources[i]] = 1;
+			queue.push_back(sources[i]);
+		}
+	}
+	// first in, first out [the result is the same in any order, but the
+	// sources move on together this way]
+	for(size_t next = 0; next < queue.size(); ++next){
+		const uint l = queue[next];
+		queued[l] = 0;
+		graph->get_impacts().any(l, [&](const uint t){
+			uint64_t lanes[FP_SWEEP_WORDS];
+			if(!passes(t, l, level_bits, restrict_level, lanes)) return false;
+			const uint owner = graph->trigger(t).owner;
+			uint64_t* to = &reach[(size_t)owner * FP_SWEEP_WORDS];
+			uint64_t grown = 0;
+			for(uint w = 0; w < FP_SWEEP_WORDS; ++w){
+				grown |= lanes[w] & ~to[w];
+				to[w] |= lanes[w];
+			}
+			if(grown && !queued[owner]){
+				queued[owner] = 1;
+				queue.push_back(owner);
+			}
+			return false;
+		});
+	}
+	for(uint w = 0; w < FP_SWEEP_WORDS; ++w) result[w] = 0;
+	for(uint l = 0; l < num_literals; l += 2)
+		for(uint w = 0; w < FP_SWEEP_WORDS; ++w)
+			result[w] |= reach[(size_t)l * FP_SWEEP_WORDS + w] & reach[(size_t)(l + 1) * FP_SWEEP_WORDS + w];
+}
+
+// all untriggered theses reaching their opposite, FP_SWEEP_LANES at a time
+void fp_sweep::contradictions(const uint level_bits, const uint restrict_level, vector<uint>& literals){
+	vector<uint> sources;
+	for(uint l = 0; l < graph->getnum_literals(); ++l)
+		if(graph->has_node(l) && !graph->node(l)->is_triggered()) sources.push_back(l);
+	literals.clear();
+	for(size_t first = 0; first < sources.size(); first += FP_SWEEP_LANES){
+		const uint count = min((size_t)FP_SWEEP_LANES, sources.size() - first);
+		uint64_t found[FP_SWEEP_WORDS];
+		run(&sources[first], count, level_bits, restrict_level, found);
+		for(uint i = 0; i < count; ++i)
+			if(found[i / 64] & ((uint64_t)1 << (i & 63))) literals.push_back(sources[first + i]);
+	}
+}
+
+// returns if from can reach 'to' [see fp_search for searching repeatedly]
+bool fp_gap(const fp_node* from, const fp_node* to, const uint level_bits, const uint restrict_level){
+	if(!from) return false;
+	fp_search search(from->get_graph());
+	return search.gap(from, to, level_bits, restrict_level);
+}
 
+ostream& operator<<(ostream& os, const fp_node& n){
+  return os << (n.triggered?"*":"") << *(n.cell) << "=" << n.thesis;
+}
+
+ostream& operator<<(ostream& os, const fp_node_list& s){
   os << "{";
-  for(fp_trigger_set::const_iterator i = s.begin(); i != s.end(); ++i)
-    os << "[" << ha(*i) << "]" << **i << " ";
+  for(fp_node_list::const_iterator i = s.begin(); i != s.end(); ++i){
+    if(*i) os << **i << " "; else os << "NULL ";
+  }
   return os << "}";
 }
 
-ostream& operator<<(ostream& os, const fp_impact_set& s){
+ostream& operator<<(ostream& os, const solv_set& s){
   os << "{";
-  for(fp_impact_set::const_iterator i = s.begin(); i != s.end(); ++i){
-    cout << "owner @" << (*i)->owner << endl;
-    if( (*i)->owner) os << *((*i)->owner) << " "; else os << "NULL ";
+  for(solv_set::const_iterator i = s.begin(); i != s.end(); ++i){
+    if(*i) os << **i << " "; else os << "NULL ";
   }
   return os << "}";
 }
@@ -2,144 +2,447 @@
  * fptree.h
  * lib to manage force-propagation-trees for sudoku solution
  * by M.Weller
- **************************************************
- *
- *
- *  ___________        ____________________________          ____________________________
- * | solv_cell |  +-->|           fp_node          |        |           fp_node          |
- * |-----------|  |   |----------------------------|        |----------------------------|
- * |nodes:     |  |   |triggers:___     __impacts:_|        |triggers:___     __impacts:_|
- * |-9:fp_node:|--+   | fp_trigger |   |fp_trigger:|------->| fp_trigger |   |fp_trigger:|----...
- * |-8:fp_node:|      |------------|   |-----------|        |------------|   |-----------|
- * |...        |      | fp_trigger |   |fp_trigger:|        | fp_trigger |   |fp_trigger:|----...
- * | 9:fp_node:|      |------------|   |-----------|        |------------|   |-----------|
- * |___________|  +-->| fp_trigger |   |fp_trigger:|--+     | fp_trigger |   |fp_trigger:|----...
- *                |   |____________|___|___________|  |     |____________|___|___________|
- *                |                                   |      
- *               ...                                  |      ____________________________
- *                                                    |     |         fp_node            |
- *                                                    |     |----------------------------|
- *                                                    |     |triggers:___     __impacts:_|
- *                                                    +---->| fp_trigger |   |fp_trigger:|
- *                                                          |------------|   |-----------|
- *                                                          | fp_trigger |   |fp_trigger:|
- *                                                          |____________|___|___________|
- */
-
-
-
+ **************************************************/
 
 #ifndef fptree_h
 #define fptree_h
 
-#include <set> // STL lists for vtree_list
-#include <list>
-#include <unordered_set> // for trigger sets
 #include <iostream>
+#include <new>
+#include <vector>
 
 #include "sudoku.h"
+#include "group_view.h"
+#include "cow_array.h"
 
 using namespace std;
 
 class solv_cell;
-/***************** force propagation trees **********************/
-
-class fp_node;
-
-typedef set<fp_node*> fp_node_set;		// an impact is a set of 
-											// treenodes which are
-											// affected by applying
-											// a certain rule to a 
-											// hypothesis
-
-typedef set<fp_node_set*> fp_node_table;	// a set of impacts, each for a
-											// different rule applied to
-											// certain hypotheses
 
+/***************** memory of the force propagation trees **********************/
 
+// the nodes of a puzzle, the node arrays of its cells and the working
+// vectors of its graph [fp_vector: flags, worklist, trail, ...] live in the
+// arena of its solv_sudoku, so dropping the puzzle is a matter of freeing a
+// few blocks. Memory given back during the solution is kept on free lists by
+// size and handed out again. The tables of the graph [triggers, antecedents
+// and adjacency] are not in the arena: they are cow_array chunks on the heap,
+// shared with the copies of the graph [see fp_graph].
+#define FP_ARENA_BLOCK 65536
+#define FP_ARENA_GRAIN 16
 
-class fp_trigger{
-  public:
-  	fp_node_set* node_set;
-  	fp_node* owner;
-  	uint level;
-  
-  fp_trigger(fp_node_set* _node_set, fp_node* _owner, const uint _level):
-    node_set(_node_set), owner(_owner), level(_level) {};
-
-  operator int() const;
+class fp_arena{
+private:
+	vector<byte*> blocks;
+	vector<byte*> big_blocks;	// for single big requests
+	size_t used;				// bytes used in the last block
+	vector<void*> free_lists;	// one per multiple of FP_ARENA_GRAIN
+	size_t allocations;			// requests served
+	size_t reused;				// requests served from the free lists
+	size_t big_bytes;			// bytes in big_blocks
+public:
+	fp_arena();
+	fp_arena(const fp_arena&) = delete;
+	fp_arena& operator=(const fp_arena&) = delete;
+	~fp_arena();
+	void* allocate(const size_t bytes);
+	void release(void* p, const size_t bytes);
+
+	template<class T, class... Args>
+	T* create(Args&&... args){
+		return new(allocate(sizeof(T))) T(std::forward<Args>(args)...);
+	}
+	template<class T>
+	void destroy(T* p){
+		p->~T();
+		release(p, sizeof(T));
+	}
+
+	size_t get_allocations() const { return allocations; }
+	size_t get_reused() const { return reused; }
+	// number of allocations from the heap
+	size_t get_blocks() const { return blocks.size() + big_blocks.size(); }
+	size_t memory() const;
+};
 
-  friend ostream& operator<<(ostream& os, const fp_trigger& t);
+// allocator for the containers of the fp-trees: takes memory from an arena,
+// or from the heap if there is none [temporary sets built by the rules]
+template<class T>
+struct fp_allocator{
+	typedef T value_type;
+	fp_arena* arena;
+
+	fp_allocator(fp_arena* _arena = NULL):arena(_arena) {};
+	template<class U>
+	fp_allocator(const fp_allocator<U>& other):arena(other.arena) {};
+
+	T* allocate(const size_t n){
+		if(arena) return (T*)arena->allocate(n * sizeof(T));
+		return (T*)::operator new(n * sizeof(T));
+	}
+	void deallocate(T* p, const size_t n){
+		if(arena) arena->release(p, n * sizeof(T));
+		else ::operator delete(p);
+	}
+};
+template<class T, class U>
+bool operator==(const fp_allocator<T>& left, const fp_allocator<U>& right){ return left.arena == right.arena; }
+template<class T, class U>
+bool operator!=(const fp_allocator<T>& left, const fp_allocator<U>& right){ return left.arena != right.arena; }
+
+/***************** force propagation graph **********************/
+
+// The theses of a puzzle are numbered densely, thesis t of the cell with
+// index c being the literal (c * num_digits + |t| - 1) * 2 + (t < 0), so
+// +t and -t are neighbours [literal ^ 1 is the opposite].
+//
+// A trigger says "if all its antecedents hold, its owner holds". All of
+// them sit in one table, their antecedents in one pool of literals. Per
+// literal, the graph keeps the triggers it owns and the triggers it is an
+// antecedent of [its impacts] in an fp_adjacency. Removed triggers are only
+// marked dead; compact() throws them out and renumbers the rest.
+//
+// Each trigger counts its antecedents that do not hold yet. Firing a thesis
+// counts down the triggers it is in, the owners of those reaching 0 go on a
+// worklist that fire() works off in order, so nothing recurses.
+//
+// While a checkpoint is open, every change goes to the trail: firing and
+// removing a thesis, adding, killing and counting down a trigger. rollback()
+// undoes them newest first [compaction waits until no checkpoint is open].
+// Checkpoints nest: each one puts an entry on the trail, so no two open ones
+// share a mark, and only the innermost one can be closed.
+//
+// The trigger table, the antecedent pool and the adjacency are cow_arrays,
+// so a copy of the graph [for a branch of the search] shares them with the
+// original until one of them writes. They live on the heap, not in the
+// arena, as they may outlive the puzzle they were copied from.
 
+class fp_node;
+class fp_graph;
+
+#define FP_NONE ((uint)-1)
+// compact the graph once there are more edges in the overflow areas than
+// in the CSR parts, but not for less than this
+#define FP_COMPACT_MIN 4096
+
+template<class T>
+using fp_vector = vector<T, fp_allocator<T> >;
+
+typedef vector<fp_node*> fp_node_list;		// antecedents of a trigger to be,
+											// NULL for a thesis that cannot
+											// hold [so the trigger never fires]
+
+inline uint fp_literal(const uint cell, const int thesis, const uint num_digits){
+	return (thesis > 0) ? (cell * num_digits + thesis - 1) * 2 : (cell * num_digits - thesis - 1) * 2 + 1;
+}
+
+// kinds of changes on the trail
+#define FP_TRAIL_FIRE    0	// a literal was triggered
+#define FP_TRAIL_REMOVE  1	// a literal was removed
+#define FP_TRAIL_INSERT  2	// a trigger was added [the last one]
+#define FP_TRAIL_KILL    3	// a trigger was killed
+#define FP_TRAIL_COUNT   4	// a trigger lost an unsatisfied antecedent
+#define FP_TRAIL_MARK    5	// a checkpoint was opened [nothing to undo]
+
+struct fp_trail_entry{
+	uint kind;
+	uint what;				// literal or trigger
 };
 
+struct fp_trigger{
+	uint owner;
+	uint level;				// LVL_* of the rule that made it
+	uint first;				// antecedents are antecedents[first, first + count)
+	uint count;
+	uint unsatisfied;		// antecedents not triggered yet
+	bool alive;
+};
 
-struct trigger_hash{
-  size_t operator()(const fp_trigger* tr) const{
-    return (int)(*tr);
-  }
+// lists of trigger numbers per literal: a CSR part [edges[offsets[l],
+// offsets[l + 1])] built by compaction, followed by a chain of the edges
+// added since in the overflow area
+class fp_adjacency{
+private:
+	struct overflow_edge{
+		uint trigger;
+		uint next;
+		uint prev;
+	};
+	cow_array<uint> offsets;
+	cow_array<uint> edges;
+	cow_array<uint> heads;		// first and last overflow edge per literal
+	cow_array<uint> tails;
+	cow_array<overflow_edge> overflow;
+public:
+	fp_adjacency(const uint num_literals);
+	void add(const uint literal, const uint trigger);
+	// take back the last edge added [it must be the last one of literal]
+	void undo_add(const uint literal);
+	size_t overflow_size() const { return overflow.size(); }
+	size_t size() const { return edges.size() + overflow.size(); }
+	// a position in the list of a literal, for walking it one edge at a time
+	struct cursor{
+		uint csr;
+		uint csr_end;
+		uint overflow;
+	};
+	cursor first(const uint literal) const{
+		const cursor result = {offsets[literal], offsets[literal + 1], heads[literal]};
+		return result;
+	}
+	// the trigger at c and step on, return false at the end of the list
+	bool next(cursor& c, uint& trigger) const{
+		if(c.csr < c.csr_end){
+			trigger = edges[c.csr++];
+			return true;
+		}
+		if(c.overflow == FP_NONE) return false;
+		trigger = overflow[c.overflow].trigger;
+		c.overflow = overflow[c.overflow].next;
+		return true;
+	}
+	// call f(trigger) for all edges of literal [dead ones included] until it
+	// returns true, return whether it did
+	template<class F>
+	bool any(const uint literal, const F& f) const{
+		for(uint i = offsets[literal]; i < offsets[literal + 1]; ++i)
+			if(f(edges[i])) return true;
+		for(uint i = heads[literal]; i != FP_NONE; i = overflow[i].next)
+			if(f(overflow[i].trigger)) return true;
+		return false;
+	}
+	// rebuild the CSR part with the triggers renumbered by remap [FP_NONE
+	// drops an edge] and empty the overflow area
+	void compact(const fp_vector<uint>& remap);
+	size_t shared_chunks() const;
+	// chunks and their bytes on the heap
+	size_t count_chunks() const;
+	size_t chunk_memory() const;
 };
-struct trigger_equal{
-  bool operator()(const fp_trigger* left, const fp_trigger* right) const{
-    const bool result=((int)(*left) == (int)(*right));
-    return result;
-  }
+
+class fp_graph{
+private:
+	const uint num_digits;
+	const uint num_literals;
+	fp_arena* arena;
+	fp_node* nodes;				// num_literals, constructed as the cells ask for them
+	fp_vector<byte> exists;		// whether the node of a literal is there [not removed]
+	cow_array<fp_trigger> triggers;
+	cow_array<uint> antecedents;	// the antecedents of a trigger are in one chunk
+	fp_adjacency owned;			// triggers a literal is the owner of
+	fp_adjacency impacts;		// triggers a literal is an antecedent of
+	size_t dead;				// dead triggers in the table
+	bool propagating;			// whether fire() works off the worklist
+	fp_vector<uint> scratch;	// antecedents of the trigger being added
+	fp_vector<uint> worklist;	// literals to fire
+	fp_vector<size_t> marks;	// of the open checkpoints, innermost last
+	fp_vector<fp_trail_entry> trail;
+	bool watching;				// whether changes are recorded
+	fp_vector<uint> changes;	// literals fired or removed [if watching]
+
+	void log(const uint kind, const uint what){
+		if(!marks.empty()){
+			const fp_trail_entry entry = {kind, what};
+			trail.push_back(entry);
+		}
+		if(watching && ((kind == FP_TRAIL_FIRE) || (kind == FP_TRAIL_REMOVE))) changes.push_back(what);
+	}
+	// add a trigger [antecedents in scratch, none triggered or removed]
+	bool insert(const uint owner, const uint level, const uint level_bits);
+	void kill(const uint trigger);
+	void compact();
+	void undo(const fp_trail_entry& entry);
+public:
+	fp_graph(const uint _num_digits, fp_arena* _arena);
+	// copy of a graph that is not firing, its nodes made by clone_node() and
+	// its memory taken from arena [the trail is not copied]
+	fp_graph(const fp_graph& other, fp_arena* _arena);
+	fp_graph(const fp_graph&) = delete;
+	fp_graph& operator=(const fp_graph&) = delete;
+
+	uint getnum_literals() const { return num_literals; }
+	fp_arena* get_arena() const { return arena; }
+	// the node of a literal [even if it was removed]
+	fp_node* node(const uint literal) const;
+	bool has_node(const uint literal) const { return exists[literal]; }
+	fp_node* create_node(solv_cell* cell, const int thesis);
+	// the node of cell standing for model in the graph model was copied from
+	fp_node* clone_node(solv_cell* cell, const fp_node& model);
+	// number of chunks of the tables shared with copies of the graph
+	size_t shared_chunks() const;
+	// chunks and their bytes on the heap
+	size_t count_chunks() const;
+	size_t chunk_memory() const;
+	const fp_trigger& trigger(const uint t) const { return triggers[t]; }
+	const uint* trigger_begin(const uint t) const { return &antecedents[triggers[t].first]; }
+	const uint* trigger_end(const uint t) const { return &antecedents[triggers[t].first] + triggers[t].count; }
+	const fp_adjacency& get_owned() const { return owned; }
+	const fp_adjacency& get_impacts() const { return impacts; }
+	// number of triggers that are alive
+	size_t count_triggers() const { return triggers.size() - dead; }
+
+	// let the given antecedents trigger owner, return whether it is a new
+	// trigger or triggered owner right away
+	bool add_trigger(fp_node* owner, const fp_node_list& nodes, const uint level, const uint level_bits);
+	// the thesis holds: fire it and everything that follows [if called
+	// while firing, node just joins the worklist]
+	void fire(fp_node* node, const uint level_bits);
+	// the thesis cannot hold: drop the node and all triggers it is in
+	void remove(fp_node* node);
+
+	// start recording changes, return the mark to roll back to
+	size_t checkpoint();
+	// undo all changes since the checkpoint of mark and close it [dies
+	// unless it is the innermost open one]
+	void rollback(const size_t mark);
+	// keep the changes since the checkpoint of mark and close it [same]
+	void commit(const size_t mark);
+	// number of changes recorded
+	size_t trail_size() const { return trail.size(); }
+	// record the literals fired or removed from now on [or stop it], for
+	// whoever wants to know which cells changed [see solv_agenda]
+	void watch(const bool on) { watching = on; changes.clear(); }
+	// the literals fired or removed since watch() or clear_changes()
+	const fp_vector<uint>& get_changes() const { return changes; }
+	void clear_changes() { changes.clear(); }
+
+	void print_trigger(ostream& os, const uint t) const;
 };
 
+// state of searches for paths in a graph: the nodes seen carry the number
+// of the search [its epoch], so starting a search is bumping a counter, and
+// the depth first search keeps its own stack. Searches of one context run
+// one at a time, but any number of contexts may search the same graph [as
+// long as nobody changes it].
+//
+// contradictions() looks at all theses at once: the triggers with a single
+// untriggered antecedent are plain implications, and theses on a cycle of
+// those follow from each other, so they share everything that follows from
+// them. Tarjan's algorithm finds these components, sinks first; each gets
+// one search [the triggers with more antecedents included]. The search
+// stops at a component known to lead to a contradiction, and takes over
+// all that follows from one known not to, as a bit set: only the triggers
+// it left waiting for more antecedents are looked at again.
+class fp_search{
+private:
+	struct frame{
+		uint literal;
+		fp_adjacency::cursor next;	// the next impact to follow
+	};
+	const fp_graph* graph;
+	vector<uint> stamps;		// per literal, the epoch it was last visited in
+	uint epoch;
+	vector<frame> stack;
+	// components of contradictions()
+	vector<uint> index;			// per literal, in order of discovery [FP_NONE: not yet]
+	vector<uint> low;			// smallest index reachable on the stack
+	vector<uint> component;		// per literal [FP_NONE: not done, triggered or removed]
+	vector<byte> bad;			// per component, whether it leads to a contradiction
+	vector<uint> members;		// theses of the components not done yet
+	vector<frame> calls;		// the recursion of Tarjan's algorithm
+	uint words;					// per set of literals
+	vector<uint64_t> closures;	// per component, the literals following from it
+	vector<uint> waiting;		// per component, the triggers missing antecedents
+	vector<uint> waiting_first;	// [waiting_first[c], waiting_first[c + 1])
+	vector<uint64_t> triggered;	// literals triggered [when the components were made]
+	vector<uint64_t> seen;		// literals of the current search
+	vector<uint> todo;			// literals to expand
+	vector<uint> recheck;		// triggers waiting in components taken over
+
+	bool visited(const uint literal) const { return stamps[literal] == epoch; }
+	void next_epoch();
+	// visit literal and push it, return true if its opposite was visited
+	bool enter(const uint literal);
+	// whether the theses following from literal [of component c] hold a
+	// thesis and its opposite [or a thesis of a bad component]; if not, keep
+	// them as the closure of c
+	bool contradicts(const uint c, const uint literal, const uint level_bits);
+	// add literal to the search, return true on a contradiction
+	bool reach(const uint c, const uint literal);
+	// whether trigger t fires once seen holds
+	bool complete(const uint t) const;
+	// the next trigger of literal that is a plain implication, FP_NONE at the end
+	uint next_implication(fp_adjacency::cursor& c, const uint level_bits) const;
+	void strongconnect(const uint literal, const uint level_bits, uint& count);
+public:
+	fp_search(const fp_graph* _graph);
+	// see fp_gap()
+	bool gap(const fp_node* from, const fp_node* to, const uint level_bits, const uint restrict_level);
+	// all untriggered theses that reach their opposite [or a thesis and its
+	// opposite] over triggers of level_bits, as fp_gap() without restriction
+	// would find them one by one
+	void contradictions(const uint level_bits, vector<uint>& literals);
+};
 
-bool trigger_triggered(const fp_trigger* trigger, const uint level_bits);
+// reachability from many theses at once: every literal carries a bit per
+// source [FP_SWEEP_LANES of them], a trigger passes on the sources all its
+// untriggered antecedents have, and literals whose bits grew go on a queue
+// until nothing changes. A source leads to a contradiction if it reaches
+// a thesis and its opposite [its own opposite included]. The triggers
+// followed are those fp_gap() follows, restrict_level included, and the
+// result does not depend on the order.
+#define FP_SWEEP_WORDS 4
+#define FP_SWEEP_LANES (64 * FP_SWEEP_WORDS)
+
+class fp_sweep{
+private:
+	const fp_graph* graph;
+	vector<uint64_t> reach;		// FP_SWEEP_WORDS per literal
+	vector<byte> triggered;		// per literal [when the sweep started]
+	vector<uint> queue;
+	vector<byte> queued;
+
+	// the sources trigger t passes on, into lanes, return false if none
+	bool passes(const uint t, const uint from, const uint level_bits, const uint restrict_level, uint64_t* lanes) const;
+public:
+	fp_sweep(const fp_graph* _graph);
+	// the sources [at most FP_SWEEP_LANES] leading to a contradiction, as
+	// bits of result [FP_SWEEP_WORDS words]
+	void run(const uint* sources, const uint count, const uint level_bits, const uint restrict_level, uint64_t* result);
+	// all untriggered theses that fp_gap() with restrict_level finds to
+	// reach their opposite
+	void contradictions(const uint level_bits, const uint restrict_level, vector<uint>& literals);
+};
 
-typedef const fp_trigger* fp_trigger_p;
-typedef const fp_trigger* fp_impact_p;
-typedef unordered_set<fp_trigger_p, trigger_hash, trigger_equal> fp_trigger_set;
-typedef set<fp_trigger_p> fp_impact_set;
+// returns if from can reach 'to' [see fp_search for searching repeatedly]
+bool fp_gap(const fp_node* from, const fp_node* to, const uint level_bits, const uint restrict_level);
 
 // force propagation tree node: a cell and one of its 
 // possibilities/non-possibilities in a sudoku grid. 
 // basically a hypothesis of placing/not placing a digit there
+// [a view into the fp_graph of the puzzle, its triggers and impacts are
+// kept there]
 class fp_node {		
 private:
+	fp_graph* graph;
 	solv_cell* cell;
 	const int thesis;	// -n means "not placing digit n"
 				// n means "placing digit n"
+	const uint literal;	// number of the thesis in the graph
 	bool triggered;	// this thesis must be true for some reason
 					// [f.ex. because the opposite can not happen]
-	fp_trigger_set* triggers;	// set of sets of nodes, any set of nodes
-								// in 'triggers' may trigger the thesis
-	fp_impact_set* impacts;	// set of sets of nodes which are triggered by
-							// this thesis
-
-	void init(const fp_trigger_set* _triggers, const fp_impact_set* _impacts);
+	// the effects of firing on the cell: drop the opposite, fill in the digit
+	void mark(const uint level_bits);
+	void unmark();
+	friend class fp_graph;
 public:
 	// constructor
-	fp_node(solv_cell* _cell, const int _thesis);
-	// copy constructor
-	fp_node(const fp_node& fpnode);
-	// destructor
-	~fp_node();
+	fp_node(fp_graph* _graph, solv_cell* _cell, const int _thesis, const uint _literal);
 	int get_thesis() const;
+	uint get_literal() const;
 	bool is_triggered() const;
 	solv_cell* get_cell() const;
+	fp_graph* get_graph() const;
 	void set_trigger(const uint level_bits);
-	// add a trigger to the trigger set and return it
-	// return a pointer to the trigger who contains
-	// the given fp_node_set
-	fp_trigger_p add_trigger(fp_node_set* _tr_node_set, const uint level, const uint level_bits);
+	// add a trigger made of the given nodes, return whether it is new or
+	// triggered *this right away
+	bool add_trigger(const fp_node_list& _tr_nodes, const uint level, const uint level_bits);
 	// add a single fp_node to the trigger set
-	fp_trigger_p add_trigger(fp_node* _tr_noder, const uint level, const uint level_bits);
+	bool add_trigger(fp_node* _tr_noder, const uint level, const uint level_bits);
   // convinience function for adding a triggers-impact relationship
   // if "tr_digit" is confirmed for all cells in "tr_cells", then trigger *this
-  bool add_triggers(set<solv_cell*>* tr_thesis_cells, const int tr_thesis_digit, const uint level, const uint level_bits);
- 
-  // remove a trigger and all its references from the node
-	bool remove_trigger(fp_trigger_p _trigger);
-	bool remove_all_triggers();
-	// add an impact to the impact set
-	bool add_impact(fp_trigger_p impact, const uint level);
-	// remove an impact from the node
-	bool remove_impact(fp_trigger_p _impact);
+  bool add_triggers(const group_view<solv_cell>& tr_thesis_cells, const int tr_thesis_digit, const uint level, const uint level_bits);
 	
-	friend bool fp_gap(const fp_node*, const fp_node*, const uint level_bits, const uint restrict_level, const uint level = 0);
   friend ostream& operator<<(ostream& os, const fp_node& n);
   friend bool operator<(const fp_node& left, const fp_node& right);
 
@@ -149,9 +452,7 @@ public:
 
 
 
-ostream& operator<<(ostream& os, const fp_node_set& s);
-ostream& operator<<(ostream& os, const fp_trigger_set& s);
-ostream& operator<<(ostream& os, const fp_impact_set& s);
+ostream& operator<<(ostream& os, const fp_node_list& s);
 
 
 
@@ -16,6 +16,7 @@
 #define gen_rules_cpp
 
 #include "gen_rules.h"
+#include "geometry.h"
 
 bool gen_rule::__apply(const uint x, const uint y, gen_sudoku* s) const{
 	return apply_func(x, y, s);
@@ -46,6 +47,10 @@ gen_cell::gen_cell(sudoku_cell* _cell){
 	cell = _cell;
 	node = new vtree_node(cell);
 }
+gen_cell::gen_cell(sudoku_cell* _cell, const gen_cell& gcell){
+	cell = _cell;
+	node = new vtree_node(*gcell.node);
+}
 gen_cell::gen_cell(const gen_cell& gcell){
 	cell = gcell.cell;
 	node = new vtree_node(*gcell.node);
@@ -74,67 +79,57 @@ uint gen_cell::get_y() const{
 
 
 
-void gen_sudoku::gen_init(vector<gen_cell*>* copy_grid){
-	ggrid = new vector<gen_cell*>(num_digits * num_digits);
-	for(uint i = 0; i < num_digits; i++)
-		for(uint j = 0; j < num_digits; j++)
-			if(copy_grid)
-				(*ggrid)[get_index(i,j)] = new gen_cell(*((*copy_grid)[get_index(i,j)]));
-			else 
-				(*ggrid)[get_index(i,j)] = new gen_cell((*grid)[get_index(i,j)]);
+void gen_sudoku::gen_init(const vector<gen_cell>* copy_grid){
+	ggrid.clear();
+	ggrid.reserve(num_digits * num_digits);
+	for(uint i = 0; i < num_digits * num_digits; i++)
+		if(copy_grid)
+			ggrid.emplace_back(cell_at(i), (*copy_grid)[i]);
+		else 
+			ggrid.emplace_back(cell_at(i));
 }
 
 // constructor
 gen_sudoku::gen_sudoku(const uint digits) : sudoku(digits){
 	gen_init();
-	gen_init();
 }
 // constructor from file
-gen_sudoku::gen_sudoku(const char* filename) : sudoku(filename, false){
+gen_sudoku::gen_sudoku(const char* filename) : sudoku(filename){
 	gen_init();
-	read_from_file(filename);
 }
 // copy constructor
 gen_sudoku::gen_sudoku(const gen_sudoku& gs) : sudoku(gs){
-	gen_init(gs.ggrid);
+	gen_init(&gs.ggrid);
 }
 // destructor
 gen_sudoku::~gen_sudoku(){
-	for(uint j = 0; j < num_digits * num_digits; j++)
-		delete (*ggrid)[j];
-	delete ggrid;
+	ggrid.clear();
 }
 gen_cell* gen_sudoku::get_cell(const uint x, const uint y) const{
-	return (*ggrid)[get_index(x,y)];
+	return const_cast<gen_cell*>(&ggrid[get_index(x,y)]);
 }
 // return a set of cells in row y
 void gen_sudoku::getrow(const uint y, set<gen_cell*>* group) const{
-	for(uint i = 0; i < num_digits; i++)
-		group->insert((*ggrid)[get_index(i,y)]);
+	getunit(geometry->unit(GROUP_ROW, y), group);
 }
 // return a set of cells in the column x
 void gen_sudoku::getcolumn(const uint x, set<gen_cell*>* group) const{
-	for(uint i = 0; i < num_digits; i++)
-		group->insert((*ggrid)[get_index(x,i)]);
+	getunit(geometry->unit(GROUP_COLUMN, x), group);
 }
 // return a set of cells in the square n
 void gen_sudoku::getsquare(const uint n, set<gen_cell*>* group) const{
-	uint order = (uint)sqrt((double)num_digits);
-	uint sq_x = n % order;
-	uint sq_y = n / order;
-	for(uint i = 0; i < order; i++)
-		for(uint j = 0; j < order; j++)
-			group->insert((*ggrid)[get_index(order * sq_x + i, order * sq_y + j)]);
+	getunit(geometry->unit(GROUP_BOX, n), group);
+}
+// return a set of cells in the unit with the given number [see geometry.h]
+void gen_sudoku::getunit(const uint unit, set<gen_cell*>* group) const{
+	for(const uint* i = geometry->unit_begin(unit); i != geometry->unit_end(unit); ++i)
+		group->insert(const_cast<gen_cell*>(&ggrid[*i]));
 }
 
 // get the [row, col, square] (dependent on group_nr) of the cell at (x,y)
 set<gen_cell*>* gen_sudoku::getgroup(const uint x, const uint y, const uint group_nr) const {
 	set<gen_cell*>* group = new set<gen_cell*>();
-	switch(group_nr){
-		case 0: getrow(x,y, group); break;
-		case 1: getcolumn(x,y, group); break;
-		case 2: getsquare(x,y, group); break;
-	}
+	if(group_nr < 3) getunit(geometry->unit_of(get_index(x, y), group_nr), group);
 	return group;
 }
 
@@ -148,21 +143,30 @@ void gen_sudoku::getcolumn(const uint x, const uint y, set<gen_cell*>* group) co
 }
 // return a set of cells in the same square as cell (x,y)
 void gen_sudoku::getsquare(const uint x, const uint y, set<gen_cell*>* group) const{
-	uint order = (uint)sqrt((double)num_digits);
-	uint sq_x = x / order;
-	uint sq_y = y / order;
-	getsquare(sq_y * order + sq_x, group);
+	getsquare(geometry->cell_box[get_index(x, y)], group);
 }
+
 // get the n'th [row, col, square] (dependent on group_nr) 
 set<gen_cell*>* gen_sudoku::getgroup(const uint n, const uint group_nr) const {
 	set<gen_cell*>* group = new set<gen_cell*>();
-	switch(group_nr){
-		case 0: getrow(n, group); break;
-		case 1: getcolumn(n, group); break;
-		case 2: getsquare(n, group); break;
-	}
+	if(group_nr < 3) getunit(geometry->unit(group_nr, n), group);
 	return group;
 }
+
+// allocation free views of the groups [see group_view.h]
+group_view<gen_cell> gen_sudoku::group(const uint x, const uint y, const uint group_nr) const{
+	return group_view<gen_cell>::unit(const_cast<gen_cell*>(&ggrid[0]), geometry, geometry->unit_of(get_index(x, y), group_nr));
+}
+group_view<gen_cell> gen_sudoku::group(const uint n, const uint group_nr) const{
+	return group_view<gen_cell>::unit(const_cast<gen_cell*>(&ggrid[0]), geometry, geometry->unit(group_nr, n));
+}
+group_list<gen_cell> gen_sudoku::groups(const uint x, const uint y) const{
+	return group_list<gen_cell>(const_cast<gen_cell*>(&ggrid[0]), geometry, get_index(x, y));
+}
+group_view<gen_cell> gen_sudoku::peers(const uint x, const uint y) const{
+	return group_view<gen_cell>::peers(const_cast<gen_cell*>(&ggrid[0]), geometry, get_index(x, y));
+}
+
 // apply a rule to a certain cell of the sudoku, return success [validity]
 bool gen_sudoku::applyrule(const uint x, const uint y, const gen_rule* r){
 	return r->apply(x, y, this);
@@ -176,16 +180,15 @@ bool gen_sudoku::applyrule(const gen_rule* r){
 // lists. return if it was removed from any vitness lists
 bool gen_sudoku::remove_node_content(vtree_node* node){
 	bool result = false;
-	for(uint i = 0; i < num_digits; i++)
-		for(uint j = 0; j < num_digits; j++)
-			result |= ((*ggrid)[get_index(i, j)])->get_node()->removenode(node);
+	for(uint i = 0; i < num_digits * num_digits; i++)
+		result |= ggrid[i].get_node()->removenode(node);
 	node->remove_content();
 	return result;
 }
 
 // add the vitness for digit to all nodes in the group
-void gen_sudoku::add_vitness(const vitness_t* v, const uint digit, set<gen_cell*>* group){
-	for(set<gen_cell*>::iterator i = group->begin(); i != group->end(); i++)
+void gen_sudoku::add_vitness(const vitness_t* v, const uint digit, const group_view<gen_cell>& group){
+	for(group_view<gen_cell>::iterator i = group.begin(); i != group.end(); ++i)
 		(*i)->get_node()->add_vitness(digit, v);
 }
 
@@ -193,8 +196,6 @@ void gen_sudoku::add_vitness(const vitness_t* v, const uint digit, set<gen_cell*
 // definition needs to go after class sudoku, bcause of getnum_digits()
 // reverse_flood: add a number as vitness for all fields in it's groups
 bool reverse_flood(const uint x, const uint y, gen_sudoku* s){
-	set<gen_cell*>* group;
-
 	gen_cell* cell = s->get_cell(x,y);
 	// cannot apply to empty cell
 	if(!cell->get_content()) return false; 
@@ -205,12 +206,8 @@ bool reverse_flood(const uint x, const uint y, gen_sudoku* s){
 	vitness->insert(node);
 	
 	// flood all 3 groups
-	for(uint j = 0; j < 3; j++){
-		group = s->getgroup(x,y,j);
-		
-		s->add_vitness(vitness, cell->get_content(), group);
-		delete group;
-	}
+	for(uint j = 0; j < 3; j++)
+		s->add_vitness(vitness, cell->get_content(), s->group(x,y,j));
 	delete vitness;
 	return true;
 }
@@ -263,7 +260,6 @@ bool reverse_eliminate(const uint x, const uint y, gen_sudoku* s){
 // the cell itself [it still is in the same group] and any other
 bool reverse_locate(const uint x, const uint y, gen_sudoku* s){
 	bool applicable;
-	set<gen_cell*>* group;
 
 	uint digit = s->get_cell(x,y)->get_content();
 
@@ -271,16 +267,15 @@ bool reverse_locate(const uint x, const uint y, gen_sudoku* s){
 	if(!digit) return false;
 
 	for(uint i = 0; i < 3; i++){
-		group = s->getgroup(x,y,i);
+		const group_view<gen_cell> group = s->group(x,y,i);
 
 		// rule can be applied if all the nodes in the current group have their
 		// 'digit' vitnessed at least twice, except if they have content
 		applicable = true;
-		for(set<gen_cell*>::iterator i = group->begin(); i != group->end(); i++)
+		for(group_view<gen_cell>::iterator i = group.begin(); i != group.end(); ++i)
 			if(((*i)->get_node()->vitnesscount(digit) < 2) && !((*i)->get_content()))
 				applicable=false;
 		
-		delete group;
 		dbgprint("reverse-locate is %sapplicable\n",applicable?"":"not ");
 
 		// if the rule is applicable, there is no need to check further groups
@@ -17,6 +17,7 @@
 
 #include "vtree.h"
 #include "sudoku.h"
+#include "group_view.h"
 
 class gen_sudoku;
 
@@ -41,6 +42,8 @@ protected:
 	sudoku_cell* cell;
 public:
 	gen_cell(sudoku_cell* _cell);
+	// copy the vitnesses of gcell, but live in _cell
+	gen_cell(sudoku_cell* _cell, const gen_cell& gcell);
 	gen_cell(const gen_cell& gcell);
 	~gen_cell();
 	vtree_node* get_node() const;
@@ -55,9 +58,10 @@ public:
 
 class gen_sudoku : public sudoku{
 private:
-	vector<gen_cell*>* ggrid;
+	// one gen_cell per cell, laid out like the flat storage of the grid
+	vector<gen_cell> ggrid;
 
-	void gen_init(vector<gen_cell*>* copy_grid = NULL);
+	void gen_init(const vector<gen_cell>* copy_grid = NULL);
 
 public:
 	// constructor
@@ -75,6 +79,8 @@ public:
 	void getcolumn(const uint x, set<gen_cell*>* group) const;
 	// return a set of cells in the square n
 	void getsquare(const uint n, set<gen_cell*>* group) const;
+	// return a set of cells in the unit with the given number [see geometry.h]
+	void getunit(const uint unit, set<gen_cell*>* group) const;
 	// get the [row, col, square] (dependent on group_nr) of the cell at (x,y)
 	set<gen_cell*>* getgroup(const uint x, const uint y, const uint group_nr) const;
 	// return a set of cells in the same row as cell (x,y)
@@ -85,6 +91,11 @@ public:
 	void getsquare(const uint x, const uint y, set<gen_cell*>* group) const;
 	// get the n'th [row, col, square] (dependent on group_nr) 
 	set<gen_cell*>* getgroup(const uint n, const uint group_nr) const;
+	// allocation free views of the groups [see group_view.h]
+	group_view<gen_cell> group(const uint x, const uint y, const uint group_nr) const;
+	group_view<gen_cell> group(const uint n, const uint group_nr) const;
+	group_list<gen_cell> groups(const uint x, const uint y) const;
+	group_view<gen_cell> peers(const uint x, const uint y) const;
 	// apply a rule to a certain cell of the sudoku, return success [validity]
 	bool applyrule(const uint x, const uint y, const gen_rule* r);
 	// apply a rule to a suitable cell in the sudoku, return success
@@ -93,7 +104,7 @@ public:
 	// lists. return if it was removed from any vitness lists
 	bool remove_node_content(vtree_node* node);
 	// add the vitness for digit to all nodes in the group
-	void add_vitness(const vitness_t* v, const uint digit, set<gen_cell*>* group);
+	void add_vitness(const vitness_t* v, const uint digit, const group_view<gen_cell>& group);
 };
 
 // reverse_flood: add a number as vitness for all fields in it's groups
@@ -0,0 +1,99 @@
+/***************************************************
+ * geometry.cpp
+ * precomputed unit and peer tables for sudoku grids
+ **************************************************/
+
+#include "geometry.h"
+#include <mutex>
+
+sudoku_geometry::sudoku_geometry(const uint _num_digits){
+	order = 0;
+	while((order + 1) * (order + 1) <= _num_digits) ++order;
+	if(order * order != _num_digits)
+		diewith("cannot build a grid with " << _num_digits << " digits: not a square number" << endl);
+
+	num_digits = _num_digits;
+	num_cells = num_digits * num_digits;
+	num_units = 3 * num_digits;
+	num_peers = 2 * (num_digits - 1) + (order - 1) * (order - 1);
+	peer_words = (num_cells + 63) / 64;
+
+	cell_row.resize(num_cells);
+	cell_col.resize(num_cells);
+	cell_box.resize(num_cells);
+	cell_units.resize(3 * num_cells);
+	for(uint cell = 0; cell < num_cells; ++cell){
+		const uint x = cell % num_digits;
+		const uint y = cell / num_digits;
+		cell_row[cell] = y;
+		cell_col[cell] = x;
+		cell_box[cell] = (y / order) * order + x / order;
+		cell_units[3 * cell + GROUP_ROW] = unit(GROUP_ROW, cell_row[cell]);
+		cell_units[3 * cell + GROUP_COLUMN] = unit(GROUP_COLUMN, cell_col[cell]);
+		cell_units[3 * cell + GROUP_BOX] = unit(GROUP_BOX, cell_box[cell]);
+	}
+
+	// walking the cells in ascending order keeps every unit sorted
+	unit_cells.resize(num_units * num_digits);
+	vector<uint> fill(num_units, 0);
+	for(uint cell = 0; cell < num_cells; ++cell)
+		for(uint group_nr = 0; group_nr < 3; ++group_nr){
+			const uint u = cell_units[3 * cell + group_nr];
+			unit_cells[u * num_digits + fill[u]++] = cell;
+		}
+
+	peer_bits.assign(num_cells * peer_words, 0);
+	peer_list.resize(num_cells * num_peers);
+	for(uint cell = 0; cell < num_cells; ++cell){
+		unsigned long long* bits = &peer_bits[cell * peer_words];
+		for(uint group_nr = 0; group_nr < 3; ++group_nr){
+			const uint u = cell_units[3 * cell + group_nr];
+			for(const uint* i = unit_begin(u); i != unit_end(u); ++i)
+				if(*i != cell) bits[*i >> 6] |= 1ULL << (*i & 63);
+		}
+		uint count = 0;
+		for(uint other = 0; other < num_cells; ++other)
+			if(is_peer(cell, other)) peer_list[cell * num_peers + count++] = other;
+		if(count != num_peers) diewith("peer table of order " << order << " is broken" << endl);
+	}
+
+	// splitmix64, seeded with the order so every run gets the same keys
+	unsigned long long seed = 0x5d0c0de5ull * num_digits;
+	zobrist_keys.resize(num_cells * (num_digits + 1));
+	cell_keys.resize(num_cells);
+	for(uint cell = 0; cell < num_cells; ++cell){
+		zobrist_keys[cell * (num_digits + 1)] = 0;
+		for(uint digit = 1; digit <= num_digits; ++digit)
+			zobrist_keys[cell * (num_digits + 1) + digit] = hash_mix(seed += 0x9e3779b97f4a7c15ull);
+		cell_keys[cell] = hash_mix(seed += 0x9e3779b97f4a7c15ull);
+	}
+}
+
+unsigned long long sudoku_geometry::hash(const byte* content) const{
+	unsigned long long result = 0;
+	for(uint cell = 0; cell < num_cells; ++cell)
+		result ^= zobrist_key(cell, content[cell]);
+	return result;
+}
+
+unsigned long long sudoku_geometry::relabel_hash(const byte* content) const{
+	vector<unsigned long long> digit_keys(num_digits + 1, 0);
+	for(uint cell = 0; cell < num_cells; ++cell)
+		digit_keys[content[cell]] ^= cell_keys[cell];
+	unsigned long long result = 0;
+	for(uint digit = 1; digit <= num_digits; ++digit)
+		result += hash_mix(digit_keys[digit]);
+	return result;
+}
+
+const sudoku_geometry* sudoku_geometry::get(const uint num_digits){
+	static mutex lock;
+	static const sudoku_geometry* tables[MASK_DIGITS + 1] = {NULL};
+
+	if(!num_digits || (num_digits > MASK_DIGITS))
+		diewith("cannot handle " << num_digits << " digits, at most " << MASK_DIGITS << " are supported" << endl);
+
+	lock_guard<mutex> guard(lock);
+	if(!tables[num_digits]) tables[num_digits] = new sudoku_geometry(num_digits);
+	return tables[num_digits];
+}
@@ -0,0 +1,94 @@
+/***************************************************
+ * geometry.h
+ * precomputed unit and peer tables for sudoku grids
+ **************************************************
+ *
+ * Everything about the shape of a grid only depends on its order, so it is
+ * computed once per order and shared by all grids of that order:
+ *
+ *   cell  -> (row, column, box)     cell_row, cell_col, cell_box
+ *   cell  -> its 3 units            cell_units
+ *   unit  -> its num_digits cells   unit_cells
+ *   cell  -> its peers              peer_list, peer_bits
+ *   (cell, digit) -> random key     zobrist_keys, cell_keys [see sudoku::get_hash()]
+ *
+ * Cells are numbered row-major [y * num_digits + x], units are numbered
+ * group_nr * num_digits + n with group_nr 0 = row, 1 = column, 2 = box,
+ * just like the arguments of getgroup().
+ */
+
+#ifndef geometry_h
+#define geometry_h
+
+#include <vector>
+
+#include "sudoku.h"
+
+using namespace std;
+
+#define GROUP_ROW    0
+#define GROUP_COLUMN 1
+#define GROUP_BOX    2
+
+class sudoku_geometry {
+public:
+	uint order;			// box side length
+	uint num_digits;	// order * order
+	uint num_cells;		// num_digits * num_digits
+	uint num_units;		// 3 * num_digits
+	uint num_peers;		// cells sharing a unit with a cell [excluding itself]
+	uint peer_words;	// 64bit words per peer bitset
+
+	vector<uint> cell_row;
+	vector<uint> cell_col;
+	vector<uint> cell_box;
+	vector<uint> cell_units;	// 3 per cell: row unit, column unit, box unit
+	vector<uint> unit_cells;	// num_digits per unit, in ascending cell order
+	vector<uint> peer_list;		// num_peers per cell, in ascending cell order
+	vector<unsigned long long> peer_bits;	// peer_words per cell
+	// random keys for hashing grids, the same in every run: one per cell
+	// and content [num_digits + 1 per cell, 0 for empty cells] and one per cell
+	vector<unsigned long long> zobrist_keys;
+	vector<unsigned long long> cell_keys;
+
+	// return the tables for grids with the given number of digits,
+	// building them on first use [thread safe, never freed]
+	static const sudoku_geometry* get(const uint num_digits);
+
+	uint unit(const uint group_nr, const uint n) const{
+		return group_nr * num_digits + n;
+	}
+	uint unit_of(const uint cell, const uint group_nr) const{
+		return cell_units[3 * cell + group_nr];
+	}
+	const uint* unit_begin(const uint unit) const{
+		return &unit_cells[unit * num_digits];
+	}
+	const uint* unit_end(const uint unit) const{
+		return &unit_cells[(unit + 1) * num_digits];
+	}
+	const uint* peers_begin(const uint cell) const{
+		return &peer_list[cell * num_peers];
+	}
+	const uint* peers_end(const uint cell) const{
+		return &peer_list[(cell + 1) * num_peers];
+	}
+	bool is_peer(const uint cell1, const uint cell2) const{
+		return (peer_bits[cell1 * peer_words + (cell2 >> 6)] >> (cell2 & 63)) & 1;
+	}
+	bool in_unit(const uint cell, const uint unit) const{
+		return cell_units[3 * cell + unit / num_digits] == unit;
+	}
+	unsigned long long zobrist_key(const uint cell, const uint digit) const{
+		return zobrist_keys[cell * (num_digits + 1) + digit];
+	}
+
+	// the hashes sudoku::get_hash() and sudoku::get_relabel_hash() of a flat grid
+	unsigned long long hash(const byte* content) const;
+	unsigned long long relabel_hash(const byte* content) const;
+
+private:
+	sudoku_geometry(const uint _num_digits);
+};
+
+#endif
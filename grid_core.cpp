@@ -0,0 +1,22 @@
+/***************************************************
+ * grid_core.cpp
+ * runtime dispatch to the grid kernels of each order
+ **************************************************/
+
+#include "grid_core.h"
+
+// every order whose digits fit into a digit_mask is instantiated
+const grid_kernels* grid_kernels::get(const uint num_digits){
+	switch(num_digits){
+		case 1:  return &grid_core<1>::kernels;
+		case 4:  return &grid_core<2>::kernels;
+		case 9:  return &grid_core<3>::kernels;
+		case 16: return &grid_core<4>::kernels;
+		case 25: return &grid_core<5>::kernels;
+		case 36: return &grid_core<6>::kernels;
+		case 49: return &grid_core<7>::kernels;
+		case 64: return &grid_core<8>::kernels;
+		default:
+			diewith("cannot handle grids with " << num_digits << " digits" << endl);
+	}
+}
@@ -0,0 +1,217 @@
+/***************************************************
+ * grid_core.h
+ * grid kernels specialized on the order of the grid
+ **************************************************
+ *
+ * The order of a grid is only known at runtime, so every loop over its
+ * cells has a bound the compiler cannot see. grid_core<Order> implements
+ * the inner loops of the grid once per order with all bounds and unit
+ * layouts as compile time constants, so the 81 cell loops of a 9x9 grid
+ * unroll and its candidate masks fit into a uint16.
+ *
+ * check_batch() validates many grids at once with GCC vector extensions:
+ * the grids are transposed so that one vector holds a cell of GRID_LANES
+ * grids, and every unit costs a few vector ops per cell for all of them.
+ *
+ * The runtime side only ever sees a grid_kernels table of function
+ * pointers. grid_kernels::get() picks the instantiation matching the
+ * number of digits found in the first line of the input; sudoku::init()
+ * stores it next to the geometry tables.
+ */
+
+#ifndef grid_core_h
+#define grid_core_h
+
+#include <stdint.h>
+#include <type_traits>
+#include <algorithm>
+
+#include "sudoku.h"
+
+// number of grids check_batch() handles side by side
+#define GRID_LANES 16
+
+// the per-order entry points, one table per instantiated order
+struct grid_kernels{
+	uint order;
+	// true iff the grid is complete and no unit contains a digit twice
+	bool (*is_valid)(const byte* content);
+	// true iff no unit contains a digit twice [empty cells are ignored]
+	bool (*is_consistent)(const byte* content);
+	// number of empty cells
+	uint (*count_empty)(const byte* content);
+	// candidate masks of all cells: the digits none of their peers contains
+	// [the mask of a filled cell contains only its content]
+	void (*candidates)(const byte* content, digit_mask* cand);
+	// set one bit per unit [numbered like in geometry.h] that contains a digit
+	// twice or, if complete, misses a digit; return the number of such units
+	uint (*failing_units)(const byte* content, const bool complete, uint64_t* failed);
+	// check count grids stored one after another, ok[i] = 1 iff grid i passes
+	void (*check_batch)(const byte* grids, const size_t count, const bool complete, byte* ok);
+
+	// return the kernels for grids with the given number of digits
+	static const grid_kernels* get(const uint num_digits);
+};
+
+// smallest unsigned type holding one bit per digit
+template<uint Digits>
+struct fixed_mask{
+	typedef typename conditional<(Digits <= 8), uint8_t,
+		typename conditional<(Digits <= 16), uint16_t,
+		typename conditional<(Digits <= 32), uint32_t, uint64_t>::type>::type>::type type;
+};
+
+template<uint Order>
+class grid_core{
+public:
+	static const uint order = Order;
+	static const uint digits = Order * Order;
+	static const uint cells = digits * digits;
+	static const uint units = 3 * digits;
+	typedef typename fixed_mask<digits>::type mask_t;
+	static const mask_t all = (mask_t)(((uint64_t)1 << (digits - 1)) * 2 - 1);
+
+	// the i'th cell of a unit [numbered like in geometry.h]
+	static uint unit_cell(const uint unit, const uint i){
+		const uint n = unit % digits;
+		switch(unit / digits){
+			case 0: return n * digits + i;
+			case 1: return i * digits + n;
+			default: return ((n / order) * order + i / order) * digits + (n % order) * order + i % order;
+		}
+	}
+
+	// OR the digit bits of each unit, remembering whether any bit was seen twice
+	static bool check_units(const byte* content, const bool complete){
+		for(uint unit = 0; unit < units; ++unit){
+			mask_t seen = 0;
+			mask_t twice = 0;
+			for(uint i = 0; i < digits; ++i){
+				const byte c = content[unit_cell(unit, i)];
+				if(!c){
+					if(complete) return false;
+					continue;
+				}
+				const mask_t bit = (mask_t)1 << (c - 1);
+				twice |= seen & bit;
+				seen |= bit;
+			}
+			if(twice) return false;
+			if(complete && (seen != all)) return false;
+		}
+		return true;
+	}
+
+	static bool is_valid(const byte* content){
+		return check_units(content, true);
+	}
+
+	static bool is_consistent(const byte* content){
+		return check_units(content, false);
+	}
+
+	static uint count_empty(const byte* content){
+		uint result = 0;
+		for(uint i = 0; i < cells; ++i)
+			result += !content[i];
+		return result;
+	}
+
+	static void candidates(const byte* content, digit_mask* cand){
+		mask_t used[units];
+		for(uint unit = 0; unit < units; ++unit){
+			used[unit] = 0;
+			for(uint i = 0; i < digits; ++i){
+				const byte c = content[unit_cell(unit, i)];
+				if(c) used[unit] |= (mask_t)1 << (c - 1);
+			}
+		}
+		for(uint i = 0; i < cells; ++i){
+			const uint x = i % digits;
+			const uint y = i / digits;
+			if(content[i])
+				cand[i] = (digit_mask)1 << (content[i] - 1);
+			else
+				cand[i] = (mask_t)(all & ~(used[y] | used[digits + x] | used[2 * digits + (y / order) * order + x / order]));
+		}
+	}
+
+	static uint failing_units(const byte* content, const bool complete, uint64_t* failed){
+		uint result = 0;
+		for(uint w = 0; w < (units + 63) / 64; ++w) failed[w] = 0;
+		for(uint unit = 0; unit < units; ++unit){
+			mask_t seen = 0;
+			mask_t twice = 0;
+			for(uint i = 0; i < digits; ++i){
+				const byte c = content[unit_cell(unit, i)];
+				const mask_t bit = c ? (mask_t)1 << (c - 1) : 0;
+				twice |= seen & bit;
+				seen |= bit;
+			}
+			if(twice || (complete && (seen != all))){
+				failed[unit / 64] |= (uint64_t)1 << (unit % 64);
+				++result;
+			}
+		}
+		return result;
+	}
+
+	// one lane per grid [aligned like mask_t, so they can live in a vector<>]
+	typedef byte lane_digits __attribute__((vector_size(GRID_LANES)));
+	typedef mask_t lane_masks __attribute__((vector_size(GRID_LANES * sizeof(mask_t)), aligned(sizeof(mask_t))));
+	struct lane_cell{ lane_masks bit; };
+
+	static void check_batch(const byte* grids, const size_t count, const bool complete, byte* ok){
+		// cell-major copy of a block of grids: the cell i of all lanes is contiguous
+		vector<byte> lanes(cells * GRID_LANES);
+		vector<lane_cell> bits(cells);
+		for(size_t block = 0; block < count; block += GRID_LANES){
+			const uint n = (count - block < GRID_LANES) ? count - block : GRID_LANES;
+			if(n < GRID_LANES) fill(lanes.begin(), lanes.end(), 0);
+			for(uint g = 0; g < n; ++g){
+				const byte* grid = grids + (block + g) * cells;
+				for(uint i = 0; i < cells; ++i)
+					lanes[i * GRID_LANES + g] = grid[i];
+			}
+			// the digit bit of every cell in every lane [0 for empty cells]
+			for(uint i = 0; i < cells; ++i){
+				lane_digits c;
+				memcpy(&c, &lanes[i * GRID_LANES], GRID_LANES);
+				const lane_masks d = __builtin_convertvector(c, lane_masks);
+				// all ones for filled cells, so d + filled = d - 1 there
+				const lane_masks filled = (lane_masks)(d != 0);
+				bits[i].bit = (1 << (d + filled)) & filled;
+			}
+
+			lane_masks bad = {};
+			for(uint unit = 0; unit < units; ++unit){
+				lane_masks seen = {};
+				lane_masks twice = {};
+				for(uint i = 0; i < digits; ++i){
+					const lane_masks bit = bits[unit_cell(unit, i)].bit;
+					twice |= seen & bit;
+					seen |= bit;
+				}
+				bad |= (lane_masks)(twice != 0);
+				if(complete) bad |= (lane_masks)(seen != all);
+			}
+			for(uint g = 0; g < n; ++g)
+				ok[block + g] = !bad[g];
+		}
+	}
+
+	static const grid_kernels kernels;
+};
+
+template<uint Order>
+const grid_kernels grid_core<Order>::kernels = {
+	Order,
+	&grid_core<Order>::is_valid,
+	&grid_core<Order>::is_consistent,
+	&grid_core<Order>::count_empty,
+	&grid_core<Order>::candidates,
+	&grid_core<Order>::failing_units,
+	&grid_core<Order>::check_batch
+};
+
+#endif
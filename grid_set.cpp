@@ -0,0 +1,112 @@
+/***************************************************
+ * grid_set.cpp
+ * storing and deduplicating millions of flat grids
+ **************************************************/
+
+#include "grid_set.h"
+
+// multiply-xorshift over 8 byte words
+uint64_t grid_hash(const byte* grid, const size_t size){
+	uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8){
+		uint64_t word;
+		memcpy(&word, grid + i, 8);
+		h = (h ^ word) * 0xff51afd7ed558ccdull;
+		h ^= h >> 32;
+	}
+	uint64_t tail = 0;
+	for(uint shift = 0; i < size; ++i, shift += 8)
+		tail |= (uint64_t)grid[i] << shift;
+	h = (h ^ tail) * 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 29;
+	h *= 0xff51afd7ed558ccdull;
+	return h ^ (h >> 32);
+}
+
+
+grid_arena::grid_arena(const size_t _grid_size):grid_size(_grid_size),used(GRID_ARENA_BLOCK){
+}
+grid_arena::~grid_arena(){
+	for(uint i = 0; i < blocks.size(); ++i)
+		delete[] blocks[i];
+}
+byte* grid_arena::alloc(){
+	if(used == GRID_ARENA_BLOCK){
+		blocks.push_back(new byte[GRID_ARENA_BLOCK * grid_size]);
+		used = 0;
+	}
+	return blocks.back() + (used++) * grid_size;
+}
+void grid_arena::undo(){
+	if(used) --used;
+}
+size_t grid_arena::memory() const{
+	return blocks.size() * GRID_ARENA_BLOCK * grid_size;
+}
+
+
+grid_set::grid_set(const size_t _grid_size):grid_size(_grid_size){
+	for(uint i = 0; i < GRID_SET_SHARDS; ++i){
+		shards[i].hashes.assign(1024, 0);
+		shards[i].grids.assign(1024, NULL);
+		shards[i].count = 0;
+	}
+}
+
+// double the table of a shard [the caller holds its lock]
+void grid_set::grow(shard& s){
+	vector<uint64_t> hashes(2 * s.hashes.size(), 0);
+	vector<const byte*> grids(2 * s.grids.size(), NULL);
+	const size_t mask = hashes.size() - 1;
+	for(size_t i = 0; i < s.grids.size(); ++i){
+		if(!s.grids[i]) continue;
+		size_t slot = s.hashes[i] & mask;
+		while(grids[slot]) slot = (slot + 1) & mask;
+		hashes[slot] = s.hashes[i];
+		grids[slot] = s.grids[i];
+	}
+	s.hashes.swap(hashes);
+	s.grids.swap(grids);
+}
+
+bool grid_set::insert(const byte* grid, const uint64_t hash){
+	shard& s = shards[hash >> 58];
+	lock_guard<mutex> guard(s.lock);
+	if(2 * (s.count + 1) > s.grids.size()) grow(s);
+	const size_t mask = s.grids.size() - 1;
+	size_t slot = hash & mask;
+	for(; s.grids[slot]; slot = (slot + 1) & mask)
+		if((s.hashes[slot] == hash) && !memcmp(s.grids[slot], grid, grid_size)) return false;
+	s.hashes[slot] = hash;
+	s.grids[slot] = grid;
+	++s.count;
+	return true;
+}
+
+bool grid_set::contains(const byte* grid, const uint64_t hash){
+	shard& s = shards[hash >> 58];
+	lock_guard<mutex> guard(s.lock);
+	const size_t mask = s.grids.size() - 1;
+	for(size_t slot = hash & mask; s.grids[slot]; slot = (slot + 1) & mask)
+		if((s.hashes[slot] == hash) && !memcmp(s.grids[slot], grid, grid_size)) return true;
+	return false;
+}
+
+size_t grid_set::size(){
+	size_t result = 0;
+	for(uint i = 0; i < GRID_SET_SHARDS; ++i){
+		lock_guard<mutex> guard(shards[i].lock);
+		result += shards[i].count;
+	}
+	return result;
+}
+
+size_t grid_set::memory(){
+	size_t result = 0;
+	for(uint i = 0; i < GRID_SET_SHARDS; ++i){
+		lock_guard<mutex> guard(shards[i].lock);
+		result += shards[i].grids.size() * (sizeof(uint64_t) + sizeof(const byte*));
+	}
+	return result;
+}
@@ -0,0 +1,74 @@
+/***************************************************
+ * grid_set.h
+ * storing and deduplicating millions of flat grids
+ **************************************************
+ *
+ * grid_arena hands out fixed size slots for grids in large blocks, so a
+ * grid is one memcpy away from being stored and never moves afterwards.
+ * Each thread owns its own arena.
+ *
+ * grid_set is a hash set of such grids shared by all threads. It is split
+ * into GRID_SET_SHARDS shards by the top bits of a 64-bit hash of the grid,
+ * each shard is an open addressing table behind its own lock. Equal
+ * hashes are confirmed by comparing the grids, so collisions are harmless.
+ */
+
+#ifndef grid_set_h
+#define grid_set_h
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include "sudoku.h"
+
+using namespace std;
+
+#define GRID_SET_SHARDS 64
+// grids per arena block
+#define GRID_ARENA_BLOCK 16384
+
+// a 64-bit hash of size bytes
+uint64_t grid_hash(const byte* grid, const size_t size);
+
+class grid_arena{
+private:
+	size_t grid_size;
+	vector<byte*> blocks;
+	size_t used;			// slots used in the last block
+public:
+	grid_arena(const size_t _grid_size);
+	grid_arena(const grid_arena&) = delete;
+	grid_arena& operator=(const grid_arena&) = delete;
+	~grid_arena();
+	// a slot for a grid [valid until the arena is destroyed]
+	byte* alloc();
+	// give back the slot handed out last
+	void undo();
+	size_t memory() const;
+};
+
+class grid_set{
+private:
+	struct shard{
+		mutex lock;
+		vector<uint64_t> hashes;
+		vector<const byte*> grids;	// NULL = free slot
+		size_t count;
+	};
+	size_t grid_size;
+	shard shards[GRID_SET_SHARDS];
+
+	void grow(shard& s);
+public:
+	grid_set(const size_t _grid_size);
+	// add a grid [the set keeps the pointer, not a copy], return false if an
+	// equal grid was in the set already
+	bool insert(const byte* grid, const uint64_t hash);
+	bool contains(const byte* grid, const uint64_t hash);
+	size_t size();
+	// bytes used by the tables [not by the grids]
+	size_t memory();
+};
+
+#endif
@@ -0,0 +1,141 @@
+/***************************************************
+ * group_view.h
+ * allocation free views of rows, columns and boxes
+ **************************************************
+ *
+ * A group_view walks the cell indices of a unit [or of the peers of a
+ * cell] in the geometry tables and hands out the cells of a grid stored
+ * in a flat array, so iterating a group neither allocates nor sorts.
+ * Views can be narrowed without copying:
+ *
+ *   s->group(x, y, i)                  the i'th group of cell (x,y)
+ *   s->group(x, y, i).minus(cell)      ... without the given cell
+ *   A.minus(B)                         cells of group A that are not in B
+ *   s->groups(x, y)                    the 3 groups of cell (x,y)
+ *   s->peers(x, y)                     all cells sharing a group with (x,y)
+ *
+ * A view leaves out one cell and one unit at most, and B must be the view
+ * of a whole unit [not of peers, nothing left out of it]; minus() dies on
+ * anything else.
+ *
+ * Views refer to the grid, they are invalidated when the grid is re-initialized.
+ */
+
+#ifndef group_view_h
+#define group_view_h
+
+#include "geometry.h"
+
+#define NO_CELL ((uint)-1)
+#define NO_UNIT ((uint)-1)
+
+template<class Cell>
+class group_view{
+protected:
+	Cell* base;			// cell 0 of the grid
+	const sudoku_geometry* geometry;
+	const uint* first;	// range of cell indices
+	const uint* last;
+	uint unit_nr;		// the unit walked by this view [NO_UNIT for peer views]
+	uint skip_cell;		// cell to leave out
+	uint skip_unit;		// unit whose cells to leave out
+
+	bool skipped(const uint cell) const{
+		return (cell == skip_cell) || ((skip_unit != NO_UNIT) && geometry->in_unit(cell, skip_unit));
+	}
+
+public:
+	class iterator{
+		const group_view* view;
+		const uint* pos;
+
+		void skip(){
+			while((pos != view->last) && view->skipped(*pos)) ++pos;
+		}
+	public:
+		iterator(const group_view* _view, const uint* _pos):view(_view),pos(_pos) { skip(); }
+		Cell* operator*() const { return view->base + *pos; }
+		uint index() const { return *pos; }
+		iterator& operator++() { ++pos; skip(); return *this; }
+		bool operator==(const iterator& i) const { return pos == i.pos; }
+		bool operator!=(const iterator& i) const { return pos != i.pos; }
+	};
+
+	group_view(Cell* _base, const sudoku_geometry* _geometry, const uint* _first, const uint* _last, const uint _unit_nr = NO_UNIT):
+		base(_base), geometry(_geometry), first(_first), last(_last), unit_nr(_unit_nr), skip_cell(NO_CELL), skip_unit(NO_UNIT) {};
+
+	// view of a whole unit of the grid
+	static group_view unit(Cell* _base, const sudoku_geometry* _geometry, const uint _unit){
+		return group_view(_base, _geometry, _geometry->unit_begin(_unit), _geometry->unit_end(_unit), _unit);
+	}
+	// view of all peers of a cell of the grid
+	static group_view peers(Cell* _base, const sudoku_geometry* _geometry, const uint cell){
+		return group_view(_base, _geometry, _geometry->peers_begin(cell), _geometry->peers_end(cell));
+	}
+
+	iterator begin() const { return iterator(this, first); }
+	iterator end() const { return iterator(this, last); }
+
+	// the same view without the given cell [dies if it already leaves one out]
+	group_view minus(const Cell* cell) const{
+		if(skip_cell != NO_CELL) diewith("leaving out a second cell of a group view" << endl);
+		group_view result(*this);
+		result.skip_cell = cell - base;
+		return result;
+	}
+	// the same view without the cells of the given unit [dies if other is no
+	// whole unit or this already leaves one out]
+	group_view minus(const group_view& other) const{
+		if(other.unit_nr == NO_UNIT) diewith("leaving out the cells of a group view that is no unit" << endl);
+		if((other.skip_cell != NO_CELL) || (other.skip_unit != NO_UNIT))
+			diewith("leaving out the cells of a group view that leaves out cells itself" << endl);
+		if(skip_unit != NO_UNIT) diewith("leaving out a second unit of a group view" << endl);
+		group_view result(*this);
+		result.skip_unit = other.unit_nr;
+		return result;
+	}
+
+	uint get_unit() const { return unit_nr; }
+	bool contains(const Cell* cell) const{
+		for(const uint* i = first; i != last; ++i)
+			if((base + *i == cell) && !skipped(*i)) return true;
+		return false;
+	}
+	uint size() const{
+		uint result = 0;
+		for(const uint* i = first; i != last; ++i)
+			if(!skipped(*i)) ++result;
+		return result;
+	}
+	bool empty() const { return begin() == end(); }
+	// the first cell of the view [the view must not be empty]
+	Cell* front() const { return *begin(); }
+};
+
+// the 3 groups [row, column, box] of a cell
+template<class Cell>
+class group_list{
+	Cell* base;
+	const sudoku_geometry* geometry;
+	uint cell;
+public:
+	class iterator{
+		const group_list* list;
+		uint group_nr;
+	public:
+		iterator(const group_list* _list, const uint _group_nr):list(_list),group_nr(_group_nr) {};
+		group_view<Cell> operator*() const{
+			return group_view<Cell>::unit(list->base, list->geometry, list->geometry->unit_of(list->cell, group_nr));
+		}
+		iterator& operator++() { ++group_nr; return *this; }
+		bool operator!=(const iterator& i) const { return group_nr != i.group_nr; }
+	};
+
+	group_list(Cell* _base, const sudoku_geometry* _geometry, const uint _cell):
+		base(_base), geometry(_geometry), cell(_cell) {};
+
+	iterator begin() const { return iterator(this, 0); }
+	iterator end() const { return iterator(this, 3); }
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "packed.h"
+#include "corpus.h"
+#include "sudoku_io.h"
+
+// convert text corpora [see corpus.h] to a packed file and back
+//
+//   pack [-m] out.pack corpus...   one section per corpus, -m adds metadata slots
+//   pack -u in.pack [section]      print all records [of a section] like lists/
+//   pack -l in.pack                list the sections
+
+const char* basename_of(const char* filename){
+	const char* slash = strrchr(filename, '/');
+	return slash ? slash + 1 : filename;
+}
+
+int pack(const char* out, char** corpora, const uint count, const uint flags){
+	packed_writer writer(out);
+	vector<byte> digits;
+	for(uint i = 0; i < count; i++){
+		corpus_reader reader(corpora[i]);
+		if(!reader.is_open()) diewith("error opening \"" << corpora[i] << "\"" << endl);
+		// a corpus without puzzles has no number of digits, it gets no section
+		if(!reader.getnum_digits()){
+			printf("%s: no puzzles, skipped\n", corpora[i]);
+			continue;
+		}
+		writer.begin_section(basename_of(corpora[i]), reader.getnum_digits(), flags);
+		digits.resize(reader.getnum_digits() * reader.getnum_digits());
+
+		corpus_entry entry;
+		const uint64_t before = writer.get_count();
+		while(reader.next(entry)){
+			if(!entry.parse(&digits[0])) diewith("error reading puzzle " << entry.number << " of \"" << corpora[i] << "\"" << endl);
+			writer.add(&digits[0]);
+		}
+		printf("%s: %llu puzzles of %u digits\n", corpora[i], (unsigned long long)(writer.get_count() - before), reader.getnum_digits());
+	}
+	writer.close();
+	return 0;
+}
+
+int unpack(const char* in, const char* name){
+	packed_corpus corpus(in);
+	if(!corpus.is_open()) diewith("\"" << in << "\" is no packed corpus" << endl);
+	corpus_writer writer("stdout");
+	vector<byte> digits;
+	string text;
+	bool first = true;
+	for(uint i = 0; i < corpus.num_sections(); i++){
+		const packed_section* s = corpus.get_section(i);
+		if(name && strncmp(s->name, name, PACKED_NAME_LENGTH)) continue;
+		digits.resize(s->num_digits * s->num_digits);
+		for(uint64_t n = s->first_record; n < s->first_record + s->count; n++){
+			corpus.get(n, &digits[0]);
+			text.clear();
+			if(!first) text += '\n';
+			first = false;
+			format_grid(&digits[0], s->num_digits, text);
+			writer.write(text);
+		}
+	}
+	return 0;
+}
+
+int list(const char* in){
+	packed_corpus corpus(in);
+	if(!corpus.is_open()) diewith("\"" << in << "\" is no packed corpus" << endl);
+	for(uint i = 0; i < corpus.num_sections(); i++){
+		const packed_section* s = corpus.get_section(i);
+		printf("%-24s %8llu puzzles from #%-8llu %2u digits, %u bytes per record%s\n", s->name,
+			(unsigned long long)s->count, (unsigned long long)s->first_record, s->num_digits, s->record_bytes,
+			(s->flags & PACKED_META) ? " with metadata" : "");
+	}
+	printf("%llu puzzles in %u sections\n", (unsigned long long)corpus.size_records(), corpus.num_sections());
+	return 0;
+}
+
+int main(int argc, char** argv){
+	if((argc > 2) && !strcmp(argv[1], "-u")) return unpack(argv[2], (argc > 3) ? argv[3] : NULL);
+	if((argc > 2) && !strcmp(argv[1], "-l")) return list(argv[2]);
+	if((argc > 3) && !strcmp(argv[1], "-m")) return pack(argv[2], argv + 3, argc - 3, PACKED_META);
+	if(argc > 2) return pack(argv[1], argv + 2, argc - 2, 0);
+
+	printf("usage: %s [-m] out.pack corpus...\n       %s -u in.pack [section]\n       %s -l in.pack\n", argv[0], argv[0], argv[0]);
+	return 1;
+}
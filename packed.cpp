@@ -0,0 +1,237 @@
+/***************************************************
+ * packed.cpp
+ * packed binary corpora with random access
+ **************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "packed.h"
+
+uint packed_cell_bits(const uint num_digits){
+	uint bits = 1;
+	while((1u << bits) <= num_digits) ++bits;
+	return bits;
+}
+
+uint packed_cell_bytes(const uint num_digits){
+	return (num_digits * num_digits * packed_cell_bits(num_digits) + 7) / 8;
+}
+
+void pack_cells(const byte* digits, const uint num_digits, byte* record){
+	const uint num_cells = num_digits * num_digits;
+	const uint bits = packed_cell_bits(num_digits);
+	memset(record, 0, packed_cell_bytes(num_digits));
+	if(bits == 4){
+		for(uint i = 0; i < num_cells; ++i)
+			record[i >> 1] |= digits[i] << ((i & 1) << 2);
+		return;
+	}
+	// cells are at most 7 bits wide, so a cell spans at most two bytes
+	for(uint i = 0, pos = 0; i < num_cells; ++i, pos += bits){
+		const uint value = (uint)digits[i] << (pos & 7);
+		record[pos >> 3] |= value & 0xff;
+		if(value >> 8) record[(pos >> 3) + 1] |= value >> 8;
+	}
+}
+
+void unpack_cells(const byte* record, const uint num_digits, byte* digits){
+	const uint num_cells = num_digits * num_digits;
+	const uint bits = packed_cell_bits(num_digits);
+	if(bits == 4){
+		for(uint i = 0; i < num_cells; ++i)
+			digits[i] = (record[i >> 1] >> ((i & 1) << 2)) & 0xf;
+		return;
+	}
+	const uint mask = (1u << bits) - 1;
+	const uint last = packed_cell_bytes(num_digits) - 1;
+	for(uint i = 0, pos = 0; i < num_cells; ++i, pos += bits){
+		const uint at = pos >> 3;
+		uint value = record[at];
+		if(at < last) value |= (uint)record[at + 1] << 8;
+		digits[i] = (value >> (pos & 7)) & mask;
+	}
+}
+
+
+packed_corpus::packed_corpus(const char* filename):data(NULL),size(0),header(NULL),sections(NULL){
+	dbgout << "opening packed corpus \"" << filename << "\"" << endl;
+	const int fd = open(filename, O_RDONLY);
+	if(fd < 0) return;
+	struct stat st;
+	if(fstat(fd, &st) || ((size_t)st.st_size < sizeof(packed_header))){
+		close(fd);
+		return;
+	}
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return;
+	data = (const byte*)map;
+	size = st.st_size;
+
+	// check the header and the section table before trusting any offset
+	header = (const packed_header*)data;
+	bool ok = !memcmp(header->magic, PACKED_MAGIC, 8) && (header->version == PACKED_VERSION) &&
+		(header->table_offset <= size) &&
+		(header->num_sections <= (size - header->table_offset) / sizeof(packed_section));
+	if(ok){
+		sections = (const packed_section*)(data + header->table_offset);
+		for(uint i = 0; ok && (i < header->num_sections); ++i){
+			const packed_section& s = sections[i];
+			ok = (s.num_digits > 0) && (s.num_digits <= MASK_DIGITS) &&
+				(s.cell_bits == packed_cell_bits(s.num_digits)) && (s.record_bytes >= packed_cell_bytes(s.num_digits)) &&
+				(s.data_offset <= size) && (s.count <= (size - s.data_offset) / s.record_bytes);
+		}
+	}
+	if(!ok){
+		dbgout << "\"" << filename << "\" is no packed corpus" << endl;
+		munmap((void*)data, size);
+		data = NULL;
+		header = NULL;
+		sections = NULL;
+	}
+}
+
+packed_corpus::~packed_corpus(){
+	if(data) munmap((void*)data, size);
+}
+
+bool packed_corpus::is_open() const{
+	return data != NULL;
+}
+uint packed_corpus::num_sections() const{
+	return header ? header->num_sections : 0;
+}
+const packed_section* packed_corpus::get_section(const uint nr) const{
+	return (nr < num_sections()) ? sections + nr : NULL;
+}
+const packed_section* packed_corpus::find_section(const char* name) const{
+	for(uint i = 0; i < num_sections(); ++i)
+		if(!strncmp(sections[i].name, name, PACKED_NAME_LENGTH)) return sections + i;
+	return NULL;
+}
+// the sections are stored in the order of their records, so bisect
+const packed_section* packed_corpus::section_of(const uint64_t n) const{
+	uint low = 0;
+	uint high = num_sections();
+	while(low < high){
+		const uint mid = (low + high) / 2;
+		if(n < sections[mid].first_record) high = mid;
+		else if(n >= sections[mid].first_record + sections[mid].count) low = mid + 1;
+		else return sections + mid;
+	}
+	return NULL;
+}
+uint64_t packed_corpus::size_records() const{
+	return header ? header->num_records : 0;
+}
+
+const byte* packed_corpus::record(const packed_section* section, const uint64_t n) const{
+	return data + section->data_offset + (n - section->first_record) * section->record_bytes;
+}
+
+bool packed_corpus::get(const uint64_t n, byte* digits, packed_meta* meta) const{
+	const packed_section* section = section_of(n);
+	if(!section) return false;
+	const byte* r = record(section, n);
+	unpack_cells(r, section->num_digits, digits);
+	if(meta){
+		if(section->flags & PACKED_META)
+			memcpy(meta, r + packed_cell_bytes(section->num_digits), sizeof(packed_meta));
+		else {
+			meta->rating = PACKED_NO_RATING;
+			meta->level = PACKED_NO_LEVEL;
+			meta->reserved = 0;
+		}
+	}
+	return true;
+}
+
+uint packed_corpus::getnum_digits(const uint64_t n) const{
+	const packed_section* section = section_of(n);
+	return section ? section->num_digits : 0;
+}
+
+
+packed_writer::packed_writer(const char* filename){
+	file = fopen(filename, "wb");
+	if(!file) diewith("error opening \"" << filename << "\" for writing" << endl);
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACKED_MAGIC, 8);
+	header.version = PACKED_VERSION;
+	// the header is rewritten by close()
+	write(&header, sizeof(header));
+}
+
+packed_writer::~packed_writer(){
+	close();
+}
+
+void packed_writer::write(const void* buffer, const size_t length){
+	if(fwrite(buffer, 1, length, file) != length)
+		diewith("error writing packed corpus" << endl);
+}
+
+// align the next section to 8 bytes
+void packed_writer::pad(){
+	static const byte zeros[8] = {0};
+	const long at = ftell(file);
+	if(at & 7) write(zeros, 8 - (at & 7));
+}
+
+void packed_writer::begin_section(const char* name, const uint num_digits, const uint flags){
+	if(!file) return;
+	// packed_corpus would refuse the whole file
+	if(!num_digits || (num_digits > MASK_DIGITS))
+		diewith("cannot pack a section \"" << name << "\" of " << num_digits << " digits" << endl);
+	pad();
+	packed_section s;
+	memset(&s, 0, sizeof(s));
+	strncpy(s.name, name, PACKED_NAME_LENGTH - 1);
+	s.num_digits = num_digits;
+	s.cell_bits = packed_cell_bits(num_digits);
+	s.record_bytes = packed_cell_bytes(num_digits) + ((flags & PACKED_META) ? sizeof(packed_meta) : 0);
+	s.flags = flags;
+	s.first_record = header.num_records;
+	s.count = 0;
+	s.data_offset = ftell(file);
+	sections.push_back(s);
+	record.assign(s.record_bytes, 0);
+}
+
+void packed_writer::add(const byte* digits, const packed_meta* meta){
+	if(sections.empty()) diewith("adding a record to a packed corpus without a section" << endl);
+	packed_section& s = sections.back();
+	pack_cells(digits, s.num_digits, &record[0]);
+	if(s.flags & PACKED_META){
+		packed_meta m = {PACKED_NO_RATING, PACKED_NO_LEVEL, 0};
+		memcpy(&record[packed_cell_bytes(s.num_digits)], meta ? meta : &m, sizeof(packed_meta));
+	}
+	write(&record[0], s.record_bytes);
+	++s.count;
+	++header.num_records;
+}
+
+void packed_writer::add(const sudoku& s, const packed_meta* meta){
+	if(sections.empty() || (sections.back().num_digits != s.getnum_digits()))
+		diewith("adding a grid of " << s.getnum_digits() << " digits to the wrong section" << endl);
+	add(s.get_contents(), meta);
+}
+
+uint64_t packed_writer::get_count() const{
+	return header.num_records;
+}
+
+void packed_writer::close(){
+	if(!file) return;
+	pad();
+	header.num_sections = sections.size();
+	header.table_offset = ftell(file);
+	if(!sections.empty()) write(&sections[0], sections.size() * sizeof(packed_section));
+	fseek(file, 0, SEEK_SET);
+	write(&header, sizeof(header));
+	fclose(file);
+	file = NULL;
+}
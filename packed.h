@@ -0,0 +1,131 @@
+/***************************************************
+ * packed.h
+ * packed binary corpora with random access
+ **************************************************
+ *
+ * A packed file holds one or more corpora [sections] of fixed size
+ * records, so the whole collection is a single mmap and puzzle N of the
+ * file is found with a look into the section table and one multiplication:
+ *
+ *   packed_header     magic, version, number of sections and records,
+ *                     offset of the section table
+ *   records           per section: count * record_bytes, 8-byte aligned
+ *   packed_section[]  the section table at the end of the file
+ *
+ * A record stores cell i in bits [i * cell_bits, (i + 1) * cell_bits) of
+ * a little-endian bit stream, cell_bits being the fewest bits holding
+ * 0..num_digits [4 for 9x9: 41 bytes instead of ~90 bytes of text].
+ * Sections written with PACKED_META append a packed_meta slot to every
+ * record. All numbers are stored in host byte order.
+ */
+
+#ifndef packed_h
+#define packed_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sudoku.h"
+
+using namespace std;
+
+#define PACKED_MAGIC "SUDPACK1"
+#define PACKED_VERSION 1
+#define PACKED_NAME_LENGTH 48
+
+// section flags
+#define PACKED_META 1
+
+// metadata not filled in [yet]
+#define PACKED_NO_RATING 0xffff
+#define PACKED_NO_LEVEL 0xff
+
+struct packed_header{
+	char magic[8];
+	uint32_t version;
+	uint32_t num_sections;
+	uint64_t num_records;
+	uint64_t table_offset;
+};
+
+struct packed_section{
+	char name[PACKED_NAME_LENGTH];	// zero terminated, usually the name of the text corpus
+	uint32_t num_digits;
+	uint32_t cell_bits;
+	uint32_t record_bytes;			// cells and metadata slot
+	uint32_t flags;
+	uint64_t first_record;			// number of the first record in the whole file
+	uint64_t count;
+	uint64_t data_offset;
+};
+
+// per record metadata slot [PACKED_META sections only]
+struct packed_meta{
+	uint16_t rating;
+	uint8_t level;		// the solving level reached [LVL_* of solv_rules.h]
+	uint8_t reserved;
+};
+
+// fewest bits holding the cell values 0..num_digits
+uint packed_cell_bits(const uint num_digits);
+// size of a record of the given order without its metadata slot
+uint packed_cell_bytes(const uint num_digits);
+// pack and unpack the num_digits * num_digits cells of a record
+void pack_cells(const byte* digits, const uint num_digits, byte* record);
+void unpack_cells(const byte* record, const uint num_digits, byte* digits);
+
+// read access to a packed file, mapped into memory as a whole
+class packed_corpus{
+private:
+	const byte* data;
+	size_t size;
+	const packed_header* header;
+	const packed_section* sections;
+
+	const byte* record(const packed_section* section, const uint64_t n) const;
+public:
+	packed_corpus(const char* filename);
+	~packed_corpus();
+	bool is_open() const;
+	uint num_sections() const;
+	const packed_section* get_section(const uint nr) const;
+	// the section with the given name, NULL if there is none
+	const packed_section* find_section(const char* name) const;
+	// the section holding record n of the file
+	const packed_section* section_of(const uint64_t n) const;
+	// number of records in the whole file
+	uint64_t size_records() const;
+
+	// fetch record n of the file [numbered across all sections]; digits
+	// receives num_digits * num_digits cells, meta the metadata if the
+	// section has some [PACKED_NO_* otherwise]
+	bool get(const uint64_t n, byte* digits, packed_meta* meta = NULL) const;
+	uint getnum_digits(const uint64_t n) const;
+};
+
+// write a packed file section by section, the header and the section
+// table are completed by close()
+class packed_writer{
+private:
+	FILE* file;
+	packed_header header;
+	vector<packed_section> sections;
+	vector<byte> record;
+
+	void write(const void* buffer, const size_t length);
+	void pad();
+public:
+	packed_writer(const char* filename);
+	~packed_writer();
+	// start a new section, all following records go there [dies unless
+	// 0 < num_digits <= MASK_DIGITS]
+	void begin_section(const char* name, const uint num_digits, const uint flags = 0);
+	// append a record to the current section
+	void add(const byte* digits, const packed_meta* meta = NULL);
+	void add(const sudoku& s, const packed_meta* meta = NULL);
+	uint64_t get_count() const;
+	void close();
+};
+
+#endif
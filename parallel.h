@@ -0,0 +1,51 @@
+/***************************************************
+ * parallel.h
+ * splitting loops over worker threads
+ **************************************************
+ *
+ * parallel_for(count, threads, body) calls body(begin, end, thread) for
+ * consecutive blocks of [0, count) on the given number of threads [the
+ * calling thread is one of them]. Blocks are handed out on demand, so
+ * slow items do not hold up the other threads. thread is in
+ * [0, threads) and lets the body use per-thread data without locking.
+ */
+
+#ifndef parallel_h
+#define parallel_h
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "sudoku.h"
+
+using namespace std;
+
+// number of threads to use if the user does not say
+inline uint default_threads(){
+	const uint n = thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+template<class Body>
+void parallel_for(const size_t count, const uint threads, const Body& body, const size_t block = 64){
+	if(!count) return;
+	if((threads <= 1) || (count <= block)){
+		body((size_t)0, count, 0u);
+		return;
+	}
+	atomic<size_t> next(0);
+	auto work = [&](const uint thread_nr){
+		size_t begin;
+		while((begin = next.fetch_add(block)) < count)
+			body(begin, (begin + block < count) ? begin + block : count, thread_nr);
+	};
+	vector<thread> workers;
+	for(uint t = 1; t < threads; ++t)
+		workers.push_back(thread(work, t));
+	work(0);
+	for(uint t = 0; t < workers.size(); ++t)
+		workers[t].join();
+}
+
+#endif
@@ -1,67 +1,100 @@
-#include "solv_rules.h"
+#include "batch.h"
+#include "parallel.h"
+#include <chrono>
+
+// all puzzles of the given corpus files [see batch.h], the results on
+// stdout and the summary on stderr; or a shard of them [-s], or all shards
+// in processes of their own [-p] and their results merged
+int batch(int argc, char** argv){
+	uint threads = 0;
+	const char* ladder_spec = DEFAULT_LADDER;
+	uint shard = 0, num_shards = 0;
+	bool all_shards = false;
+	const char* prefix = NULL;
+	int arg = 2;
+	for(; (arg + 1 < argc) && (argv[arg][0] == '-'); arg += 2)
+		if(!strcmp(argv[arg], "-t")) threads = atoi(argv[arg + 1]);
+		else if(!strcmp(argv[arg], "-l")) ladder_spec = argv[arg + 1];
+		else if(!strcmp(argv[arg], "-o")) prefix = argv[arg + 1];
+		else if(!strcmp(argv[arg], "-p")) all_shards = ((num_shards = atoi(argv[arg + 1])) > 0);
+		else if(!strcmp(argv[arg], "-s")){
+			if((sscanf(argv[arg + 1], "%u/%u", &shard, &num_shards) != 2) || (shard >= num_shards))
+				diewith("bad shard " << argv[arg + 1] << " [it is shard/shards, counting from 0]" << endl);
+		} else diewith("unknown option " << argv[arg] << endl);
+	if(arg == argc) diewith("no corpus files given" << endl);
+	if(num_shards && !prefix) diewith("shards need an output prefix [-o]" << endl);
+	const vector<const char*> files(argv + arg, argv + argc);
+	// shards running at once share the cores
+	if(!threads) threads = max(default_threads() / (all_shards ? num_shards : 1), 1u);
+
+	if(all_shards){
+		if(!run_shards(files, num_shards, prefix, ladder_spec, threads)) return 1;
+		fprintf(stderr, "%zu puzzles merged\n", merge_shards(prefix, num_shards, stdout));
+		return 0;
+	}
+	batch_solver solver(ladder_spec, threads);
+	if(num_shards) solver.solve_shard(files, shard, num_shards, prefix);
+	else for(size_t f = 0; f < files.size(); f++){
+		corpus_reader reader(files[f]);
+		if(!reader.is_open()){
+			fprintf(stderr, "error opening \"%s\"\n", files[f]);
+			return 1;
+		}
+		solver.solve(files[f], reader, stdout);
+	}
+	solver.print_summary(stderr);
+	return 0;
+}
 
 int main(int argc, char** argv){
 	solv_sudoku* su;
 
-	// read a sudoku grid from a filename provided by the user, or stdin
+	// read a sudoku grid from a filename provided by the user, or stdin,
+	// and the rules to use, cheapest first [see solv_ladder in agenda.h],
+	// or solve whole corpora
+	//
+	//   solv [file] [rule,rule,...]
+	//   solv -b [-t threads] [-l rule,rule,...] [-o prefix -s shard/shards | -p shards] file...
+	//   solv -m prefix shards
+	if((argc > 1) && !strcmp(argv[1], "-b")) return batch(argc, argv);
+	if((argc > 3) && !strcmp(argv[1], "-m")){
+		fprintf(stderr, "%zu puzzles merged\n", merge_shards(argv[2], atoi(argv[3]), stdout));
+		return 0;
+	}
 
 	const char* filename = (argc>1 ? argv[1] : "stdin");
+	const char* ladder_spec = (argc>2 ? argv[2] : DEFAULT_LADDER);
+	solv_ladder ladder(ladder_spec);
 	printf("reading file %s\n", filename);
-	su = new solv_sudoku(filename, 0);
-	su->print();
-
-	// create rule-objects to use with the sudoku grid
-	solv_rule* floodrule = new solv_rule(flood);
-	solv_rule* tcarule = new solv_rule(tca);
-//	solv_rule* tcarule = new solv_rule(bigraph);
-//	solv_rule* tcarule = new solv_rule(ebigraph);
-	solv_rule* eliminaterule = new solv_rule(eliminate);
-	solv_rule* locaterule = new solv_rule(locate);
-	solv_rule* alignrule = new solv_rule(alignment);
-	solv_rule* intersectrule = new solv_rule(group_intersect);
-
-	// apply the rule objcts in the given order
-	int count = 0;
-	printf("applying flood\n");
-	while(su->applyrule(floodrule, LVL_ALL)) count++;
-	printf("flood rounds %d\n", count);
+	// a puzzle without a solution is thrown [see invalidwith()]
+	try{
+		su = new solv_sudoku(filename, 0);
+	} catch(const invalid_sudoku& e) diewith(e.what() << endl);
 	su->print();
 
-	count = 0;
-	printf("applying eliminate\n");
-	while(su->applyrule(eliminaterule, LVL_ALL)) count++;
-	printf("eliminate rounds %d\n", count);
-	su->print();
-	
-	count = 0;
-	printf("applying locate\n");
-	while(su->applyrule(locaterule, LVL_ALL)) count++;
-	printf("locate rounds %d\n", count);
-	su->print();
-
-	count = 0;
-	printf("applying group_intersect\n");
-	while(su->applyrule(intersectrule, LVL_ALL)) count++;
-	printf("group_intersect rounds %d\n", count);
+	// apply the rules where their inputs change, going up the ladder only
+	// when the cheaper ones are stuck
+	printf("applying %s\n", ladder_spec);
+	solv_agenda agenda(su, ladder.get_rules());
+	size_t found = 0;
+	try{
+		found = agenda.run(LVL_ALL);
+	} catch(const invalid_sudoku& e) diewith(e.what() << endl);
+	printf("%zu rule applications, %zu found something\n", agenda.get_calls(), found);
 	su->print();
+	if(su->count_empty()) printf("stuck after tier %u (%s)\n", agenda.get_tier(), ladder.tier_name(agenda.get_tier()));
+	else printf("solved at tier %u (%s)\n", agenda.get_tier(), ladder.tier_name(agenda.get_tier()));
 
-	count = 0;
-	printf("applying alignment\n");
-	while(su->applyrule(alignrule, LVL_ALL)) count++;
-	printf("alignment rounds %d\n", count);
-	su->print();
-
-/*
-	count = 0;
-	printf("applying tca\n");
-	while(su->applyrule(tcarule, LVL_ALL)) count++;
-	printf("tca rounds %d\n", count);
-	su->print();
-*/
+	// the nodes and working vectors come from the arena, the tables of the
+	// graph are chunks of their own [see fp_arena]
+	const fp_arena& arena = su->get_arena();
+	printf("fp-tree memory: %zu allocations [%zu reused] in %zu heap blocks, %zu KB\n",
+		arena.get_allocations(), arena.get_reused(), arena.get_blocks(), arena.memory() / 1024);
+	printf("fp-graph tables: %zu chunks, %zu KB\n", su->get_graph().count_chunks(), su->get_graph().chunk_memory() / 1024);
 
   cout << "cleaning up..." << endl;
-	delete tcarule;
-	delete floodrule;
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
 	delete su;
+	printf("teardown took %.1fus\n", chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
   cout << "done. Goodbye." << endl;
 }
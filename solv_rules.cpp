@@ -20,15 +20,19 @@ Rules are:
 #define solv_rules_cpp
 
 #include "solv_rules.h"
-#include <algorithm> // for set_difference
+#include "geometry.h"
+#include "sudoku_io.h"
+#include "corpus.h"
 #include <unordered_set>
 #include "align.h"
+#include "parallel.h"
 
 bool solv_rule::__apply(const uint x, const uint y, solv_sudoku* s, const uint level_bits) const{
 	return apply_func(x, y, s, level_bits);
 }
-solv_rule::solv_rule(bool (*apply_f)(const uint x, const uint y, solv_sudoku*, const uint)){
+solv_rule::solv_rule(bool (*apply_f)(const uint x, const uint y, solv_sudoku*, const uint), const uint _scope){
 	apply_func = apply_f;
+	scope = _scope;
 	lastx = 0;
 	lasty = 0;
 }
@@ -63,50 +67,52 @@ solv_rule::~solv_rule(){
 void solv_cell::sinit(const uint _num_digits){
 	int content = cell->get_content();
   num_digits = _num_digits;
-	nodes = new vector<fp_node*>(2 * _num_digits + 1);
+	nodes = (fp_node**)graph->get_arena()->allocate((2 * _num_digits + 1) * sizeof(fp_node*));
+	for(uint i = 0; i < 2 * _num_digits + 1; i++) nodes[i] = NULL;
+	// every thesis gets its node [so copies of the graph find them all]
+	for(int i = -_num_digits; i <= (int)_num_digits; i++) 
+		if(i)
+			nodes[i + _num_digits] = graph->create_node(this, i);
 	// if the connected cell already has a content [!=0], then there is only 1 positive thesis
 	// all negative theses except -content are triggered as well
 	if(content){
-		for(int i = 1; i < (int)_num_digits; i++) if(i != content)
-			(*nodes)[i + _num_digits] = NULL;
-		for(int i = -_num_digits; i < 0; i++) if(i != -content){
-			(*nodes)[i + _num_digits] = new fp_node(this, i);
-			(*nodes)[i + _num_digits]->set_trigger(0);
+		for(int i = 1; i <= (int)_num_digits; i++) if(i != content){
+			graph->remove(nodes[i + _num_digits]);
+			nodes[i + _num_digits] = NULL;
 		}
-		(*nodes)[content + _num_digits] = new fp_node(this, content);
-		(*nodes)[content + _num_digits]->set_trigger(0);
-	} else {
-		for(int i = -_num_digits; i <= (int)_num_digits; i++) 
-			if(i)
-				(*nodes)[i + _num_digits] = new fp_node(this, i);
-			else
-				(*nodes)[i + _num_digits] = NULL;
+		for(int i = -_num_digits; i < 0; i++) if(i != -content)
+			nodes[i + _num_digits]->set_trigger(0);
+		nodes[content + _num_digits]->set_trigger(0);
 	}
 }
 
-solv_cell::solv_cell(const uint _num_digits, const uint _x, const uint _y, const uint _content){
-	cell = new sudoku_cell(_num_digits, _x, _y, _content);
-	sinit(_num_digits);
+solv_cell::solv_cell(sudoku_cell* _cell, fp_graph* _graph){
+	cell = _cell;
+	graph = _graph;
+	sinit(cell->get_num_digits());
 }
 
-solv_cell::solv_cell(sudoku_cell* _cell){
+// the nodes of the copy are those of model with the same literals, removed
+// ones included [the triggers of the graph refer to them]
+solv_cell::solv_cell(const solv_cell& model, sudoku_cell* _cell, fp_graph* _graph){
 	cell = _cell;
-	sinit(cell->get_num_digits());
+	graph = _graph;
+  num_digits = model.num_digits;
+	nodes = (fp_node**)graph->get_arena()->allocate((2 * num_digits + 1) * sizeof(fp_node*));
+	nodes[num_digits] = NULL;
+	for(int i = -num_digits; i <= (int)num_digits; i++)
+		if(i){
+			fp_node* node = graph->clone_node(this, *model.graph->node(fp_literal(get_index(), i, num_digits)));
+			nodes[i + num_digits] = model.nodes[i + num_digits] ? node : NULL;
+		}
 }
 
+// the copy shares the theses of _scell
 solv_cell::solv_cell(const solv_cell& _scell){
 	cell = _scell.cell;
+	graph = _scell.graph;
   num_digits = _scell.num_digits;
-	nodes = new vector<fp_node*>(*_scell.nodes);
-}
-
-solv_cell::~solv_cell(){
-	for(uint i = 0; i < nodes->size(); i++)
-		if((*nodes)[i]) {
-      delete (*nodes)[i];
-      (*nodes)[i] = NULL;
-    }
-	delete nodes;
+	nodes = _scell.nodes;
 }
 
 // return the fp_node of the given number (digit) for this cell
@@ -118,7 +124,7 @@ fp_node*& solv_cell::operator[](const int digit) {
   if((-digit > (int)digits) || (digit > (int)digits) || (digit == 0))
     diewith("invalid access to nonexistent digit " << digit << endl);
 
-	return (*nodes)[digit + cell->get_num_digits()];
+	return nodes[digit + cell->get_num_digits()];
 }
 
 fp_node* const& solv_cell::operator[](const int digit) const{
@@ -127,7 +133,7 @@ fp_node* const& solv_cell::operator[](const int digit) const{
   if((-digit > (int)digits) || (digit > (int)digits) || (digit == 0))
     diewith("invalid access to nonexistent digit " << digit << endl);
 
-	return (*nodes)[digit + cell->get_num_digits()];
+	return nodes[digit + cell->get_num_digits()];
 }
 
 
@@ -136,7 +142,7 @@ uint solv_cell::get_content() const{
 }
 bool solv_cell::remove_thesis(const int digit, const uint level_bits){
 	const uint _num_digits = cell->get_num_digits();
-  fp_node*& node = (*nodes)[digit + _num_digits];
+  fp_node*& node = nodes[digit + _num_digits];
 
 	
 	// cannot remove, what was removed already
@@ -148,10 +154,12 @@ bool solv_cell::remove_thesis(const int digit, const uint level_bits){
 
 	// removing a triggered thesis is very wrong...
 	if(node->is_triggered())
-    diewith("sudoku is invalid: trying to remove triggered thesis " << *node << endl);
+    invalidwith("sudoku is invalid: trying to remove triggered thesis " << *node);
 	
-	delete node;
+	graph->remove(node);
   node = NULL;
+  // the candidate mask of the grid mirrors the existing positive theses
+  if(digit > 0) cell->set_candidates(cell->get_candidates() & ~((digit_mask)1 << (digit - 1)));
 
   // this function does not set triggers, it is called by set_trigger only!!!
 	// if x can never be triggered, then -x must be triggered and vice versa
@@ -160,6 +168,17 @@ bool solv_cell::remove_thesis(const int digit, const uint level_bits){
 }
 
 
+// take back remove_thesis()
+void solv_cell::restore_thesis(fp_node* node){
+	const int digit = node->get_thesis();
+	nodes[digit + cell->get_num_digits()] = node;
+  if(digit > 0) cell->set_candidates(cell->get_candidates() | ((digit_mask)1 << (digit - 1)));
+}
+// take back set_content()
+void solv_cell::restore_content(const uint digit){
+	cell->set_content(digit);
+}
+
 void solv_cell::set_content(const uint digit, const uint level_bits){
 	dbgprint("setting content for [%d,%d] to %d\n",cell->get_x(), cell->get_y(), digit);
 	if(digit <= 0)
@@ -167,7 +186,7 @@ void solv_cell::set_content(const uint digit, const uint level_bits){
 
 	cell->set_content(digit);
 	// trigger the thesis if it is not already
-	(*nodes)[digit + cell->get_num_digits()]->set_trigger(level_bits);
+	nodes[digit + cell->get_num_digits()]->set_trigger(level_bits);
 }
 void solv_cell::remove_content(){
 	set_content(0,0);
@@ -179,101 +198,104 @@ uint solv_cell::get_y() const{
 	return cell->get_y();
 }
 uint solv_cell::count_poss() const{
-	uint res = 0;
-	const uint digits = cell->get_num_digits();
-	for(uint i = 1; i <= digits; i++)
-		if((*nodes)[i + digits]) res++;
-	return res;
+	return __builtin_popcountll(cell->get_candidates());
 }
 uint solv_cell::getnum_digits() const{
   return num_digits;
 }
+uint solv_cell::get_index() const{
+	return cell->get_index();
+}
 
 
 void solv_sudoku::solv_init(const uint level_bits){
-	// init the sgrid
-	sgrid = new vector<solv_cell*>(num_digits * num_digits);
-	for(uint i = 0; i < num_digits; i++)
-		for(uint j = 0; j < num_digits; j++)
-			(*sgrid)[get_index(i,j)] = new solv_cell((*grid)[get_index(i,j)]);
+	// init the sgrid [the fp_nodes refer to their solv_cell by address,
+	// so reserve first to never move them]
+	graph = arena.create<fp_graph>(num_digits, &arena);
+	sgrid.clear();
+	sgrid.reserve(num_digits * num_digits);
+	for(uint i = 0; i < num_digits * num_digits; i++)
+		sgrid.emplace_back(cell_at(i), graph);
 }
 
 // constructor
 solv_sudoku::solv_sudoku(const uint digits, const uint level_bits) : sudoku(digits){
 	solv_init(level_bits);
 }
-// constructor from file
+// constructor from file [the first puzzle if it holds many]
 solv_sudoku::solv_sudoku(const char* filename, const uint level_bits) : sudoku(){
-	char* s = read_first_line(filename);
+	corpus_reader reader(filename);
+	if(!reader.is_open()) diewith("error opening \"" << filename << "\"" << endl);
+	corpus_entry entry;
+	if(!reader.next(entry)) diewith("error reading \"" << filename << "\": bad format" << endl);
 
-	init(strlen(s));
-	dbgprint("number of digits: %d, input is %s, first line is %s\n", num_digits, strcmp(filename, "stdin")?"a file":"stdin", s);
+	init(entry.num_digits);
+	dbgprint("number of digits: %d, input is %s\n", num_digits, strcmp(filename, "stdin")?"a file":"stdin");
 	solv_init(level_bits);
-	
-	read_from_file(filename, strcmp(filename,"stdin")?NULL:s);
-	free(s);
+	set_givens(entry, level_bits);
+}
+// constructor from a puzzle of a corpus
+solv_sudoku::solv_sudoku(const corpus_entry& entry, const uint level_bits) : sudoku(entry.num_digits){
+	solv_init(level_bits);
+	set_givens(entry, level_bits);
+}
+// trigger the given digits of a puzzle [the sgrid must be fresh]
+void solv_sudoku::set_givens(const corpus_entry& entry, const uint level_bits){
+	vector<byte> givens(num_digits * num_digits);
+	if((entry.num_digits != num_digits) || !entry.parse(&givens[0]))
+		invalidwith("error reading puzzle " << entry.number << ": not enough digits");
 
-	uint c;
 	for(uint x = 0; x < num_digits; x++)
 		for(uint y = 0; y < num_digits; y++)
-			if((c = (*grid)[get_index(x,y)]->get_content()))
-				(*sgrid)[get_index(x,y)]->set_content(c, level_bits);
-
+			if(givens[get_index(x,y)])
+				sgrid[get_index(x,y)].set_content(givens[get_index(x,y)], level_bits);
 }
-// copy constructor [TODO]
+// copy constructor [the grid is copied, the graph shares its tables with
+// the one of gs and the nodes are cloned into the arena of the copy]
 solv_sudoku::solv_sudoku(const solv_sudoku& gs) : sudoku(gs){
-	printf("oh noes, copy construction...\n");
-	exit(0);
+	graph = arena.create<fp_graph>(*gs.graph, &arena);
+	sgrid.reserve(num_digits * num_digits);
+	for(uint i = 0; i < num_digits * num_digits; i++)
+		sgrid.emplace_back(gs.sgrid[i], cell_at(i), graph);
 }
-// destructor
+// destructor [the fp-trees go with the arena in one go, only the graph
+// lets go of its tables, which may be shared with copies]
 solv_sudoku::~solv_sudoku(){
-	for(uint i = 0; i < num_digits * num_digits; i++){
-		delete (*sgrid)[i];
-    (*grid)[i] = NULL;
-  }
-	delete sgrid;
-  sgrid = NULL;
+	sgrid.clear();
+	arena.destroy(graph);
 }
 fp_node* solv_sudoku::get_thesis(const uint x, const uint y, const int thesis) const{
-	return (*(*sgrid)[get_index(x,y)])[thesis];
+	return sgrid[get_index(x,y)][thesis];
 }
 solv_cell* solv_sudoku::get_cell(const uint x, const uint y) const{
-	return (*sgrid)[get_index(x,y)];
+	return const_cast<solv_cell*>(&sgrid[get_index(x,y)]);
 }
 
 // return a set of cells in row y
 void solv_sudoku::getrow(const uint y, set<solv_cell*>* group) const{
-	for(uint i = 0; i < num_digits; ++i)
-		group->insert((*sgrid)[get_index(i,y)]);
+	getunit(geometry->unit(GROUP_ROW, y), group);
 }
 // return a set of cells in the column x
 void solv_sudoku::getcolumn(const uint x, set<solv_cell*>* group) const{
-	for(uint i = 0; i < num_digits; i++)
-		group->insert((*sgrid)[get_index(x,i)]);
+	getunit(geometry->unit(GROUP_COLUMN, x), group);
 }
-
 // return a set of cells in the square n
 void solv_sudoku::getsquare(const uint n, set<solv_cell*>* group) const{
-	const uint order = (uint)sqrt((double)num_digits);
-	const uint sq_x = n % order;
-	const uint sq_y = n / order;
-	for(uint i = 0; i < order; i++)
-		for(uint j = 0; j < order; j++)
-			group->insert((*sgrid)[get_index(order * sq_x + i, order * sq_y + j)]);
+	getunit(geometry->unit(GROUP_BOX, n), group);
+}
+// return a set of cells in the unit with the given number [see geometry.h]
+void solv_sudoku::getunit(const uint unit, set<solv_cell*>* group) const{
+	for(const uint* i = geometry->unit_begin(unit); i != geometry->unit_end(unit); ++i)
+		group->insert(const_cast<solv_cell*>(&sgrid[*i]));
 }
 
 // get the [row, col, square] (dependent on group_nr) of the cell at (x,y)
 set<solv_cell*>* solv_sudoku::getgroup(const uint x, const uint y, const uint group_nr) const {
 	set<solv_cell*>* group = new set<solv_cell*>();
-	switch(group_nr){
-		case 0: getrow(x,y, group); break;
-		case 1: getcolumn(x,y, group); break;
-		case 2: getsquare(x,y, group); break;
-	}
+	if(group_nr < 3) getunit(geometry->unit_of(get_index(x, y), group_nr), group);
 	return group;
 }
 
-
 // return a set of cells in the same row as cell (x,y)
 void solv_sudoku::getrow(const uint x, const uint y, set<solv_cell*>* group) const{
 	getrow(y,group);
@@ -284,23 +306,30 @@ void solv_sudoku::getcolumn(const uint x, const uint y, set<solv_cell*>* group)
 }
 // return a set of cells in the same square as cell (x,y)
 void solv_sudoku::getsquare(const uint x, const uint y, set<solv_cell*>* group) const{
-	const uint order = (uint)sqrt((double)num_digits);
-	const uint sq_x = x / order;
-	const uint sq_y = y / order;
-	getsquare(sq_y * order + sq_x, group);
+	getsquare(geometry->cell_box[get_index(x, y)], group);
 }
 
 // get the n'th [row, col, square] (dependent on group_nr) 
 set<solv_cell*>* solv_sudoku::getgroup(const uint n, const uint group_nr) const {
 	set<solv_cell*>* group = new set<solv_cell*>();
-	switch(group_nr){
-		case 0: getrow(n, group); break;
-		case 1: getcolumn(n, group); break;
-		case 2: getsquare(n, group); break;
-	}
+	if(group_nr < 3) getunit(geometry->unit(group_nr, n), group);
 	return group;
 }
 
+// allocation free views of the groups [see group_view.h]
+group_view<solv_cell> solv_sudoku::group(const uint x, const uint y, const uint group_nr) const{
+	return group_view<solv_cell>::unit(const_cast<solv_cell*>(&sgrid[0]), geometry, geometry->unit_of(get_index(x, y), group_nr));
+}
+group_view<solv_cell> solv_sudoku::group(const uint n, const uint group_nr) const{
+	return group_view<solv_cell>::unit(const_cast<solv_cell*>(&sgrid[0]), geometry, geometry->unit(group_nr, n));
+}
+group_list<solv_cell> solv_sudoku::groups(const uint x, const uint y) const{
+	return group_list<solv_cell>(const_cast<solv_cell*>(&sgrid[0]), geometry, get_index(x, y));
+}
+group_view<solv_cell> solv_sudoku::peers(const uint x, const uint y) const{
+	return group_view<solv_cell>::peers(const_cast<solv_cell*>(&sgrid[0]), geometry, get_index(x, y));
+}
+
 // apply a rule to a certain cell of the sudoku, return success [validity]
 bool solv_sudoku::applyrule(const uint x, const uint y, solv_rule* r, const uint level_bits){
 	return r->apply(x, y, this, level_bits);
@@ -314,8 +343,23 @@ bool solv_sudoku::applyrule(solv_rule* r, const uint level_bits){
 
 // get "neg(thesis)"
 fp_node* solv_sudoku::get_opposite(const fp_node* thesis){
-	solv_cell* sc = (*sgrid)[get_index(thesis->get_cell()->get_x(), thesis->get_cell()->get_y())];
-	return (*sc)[-(thesis->get_thesis())];
+	const solv_cell& sc = sgrid[get_index(thesis->get_cell()->get_x(), thesis->get_cell()->get_y())];
+	return sc[-(thesis->get_thesis())];
+}
+const fp_arena& solv_sudoku::get_arena() const{
+	return arena;
+}
+const fp_graph& solv_sudoku::get_graph() const{
+	return *graph;
+}
+size_t solv_sudoku::checkpoint(){
+	return graph->checkpoint();
+}
+void solv_sudoku::rollback(const size_t mark){
+	graph->rollback(mark);
+}
+void solv_sudoku::commit(const size_t mark){
+	graph->commit(mark);
 }
 	
 
@@ -336,13 +380,10 @@ bool group_flood(const uint x, const uint y, const int digit, solv_sudoku* s, co
 
 	bool result =  false;
 	for(uint i = 0; i < 3; ++i){
-	  set<solv_cell*>* group = s->getgroup(x,y,i);
-    
-    dbgout << "erasing " << *(thesis->get_cell()) << endl;
-		group->erase(thesis->get_cell());
+    const group_view<solv_cell> group = s->group(x,y,i).minus(thesis->get_cell());
 
     // for each thesis -digit in the group, add a trigger from "thesis" to it
-    for(set<solv_cell*>::iterator i = group->begin(); i != group->end(); ++i){
+    for(group_view<solv_cell>::iterator i = group.begin(); i != group.end(); ++i){
       fp_node* node = (**i)[-digit];
       
       if(node){
@@ -352,6 +393,8 @@ bool group_flood(const uint x, const uint y, const int digit, solv_sudoku* s, co
       } else {
         // if (**i)[-digit] cannot be triggered, then thesis cannot be triggered
         fp_node* neg_thesis = s->get_opposite(thesis);
+        // [gone as well if the cell holds the digit: it is twice in the group]
+        if(!neg_thesis) invalidwith("sudoku is invalid: the digit of " << *thesis << " is twice in one of its groups");
         neg_thesis->set_trigger(level_bits);
         // of course, thesis is now invalid
         return result;
@@ -382,7 +425,7 @@ bool cell_flood(const uint x, const uint y, const int digit, solv_sudoku* s, con
     if(cell[-i]){
       dbgout << "cell[" << -i << "] exists at " << cell[-i] << ":" << endl;
       dbgout << *(cell[-i]) << endl;
-      result |= ( cell[-i]->add_trigger(thesis, LVL_FLOOD, level_bits) != NULL);
+      result |= cell[-i]->add_trigger(thesis, LVL_FLOOD, level_bits);
     } else {
       // if cell[-i] doesn't exist, then cell[digit] cannot be triggered.
       // Hence, trigger cell[-digit]
@@ -423,20 +466,15 @@ bool eliminate(solv_cell* cell, const int digit, const uint num_digits, const ui
 
 	fp_node* node = (*cell)[digit];
 	if(node) {
-	  fp_node_set* neg_theses = new fp_node_set();
+	  fp_node_list neg_theses;
 		for(int j = -num_digits; j < 0; ++j) if(j != -digit){
       fp_node* tmp_node = (*cell)[j];
       if(tmp_node)
         if(! tmp_node->is_triggered())
-          neg_theses->insert(tmp_node);
-    }
-    dbgout << "calling add_trigger with " << *neg_theses << " --> " << *node << endl;
-		if(node->add_trigger(neg_theses, LVL_ELIMINATE, level_bits)){
-      return true;
-    }else{
-      delete neg_theses;
-      return false;
+          neg_theses.push_back(tmp_node);
     }
+    dbgout << "calling add_trigger with " << neg_theses << " --> " << *node << endl;
+		return node->add_trigger(neg_theses, LVL_ELIMINATE, level_bits);
 	}
 	return false;
 }
@@ -460,7 +498,6 @@ bool eliminate(const uint x, const uint y, solv_sudoku* s, const uint level_bits
 // if a digit has only one possibility for any group left, fill it in
 bool locate(const uint x, const uint y, const int digit, solv_sudoku* s, const uint level_bits){
 	dbgout << "(" << x << "," << y << ")" << endl << "===========================" << endl;
-	set<solv_cell*>* group;
 	fp_node* thesis;
 
 	// cannot apply to negative thesis
@@ -471,13 +508,8 @@ bool locate(const uint x, const uint y, const int digit, solv_sudoku* s, const u
 		thesis = s->get_thesis(x,y,digit);
 		if(!thesis) return false;
 
-		group = s->getgroup(x,y,i);
-		group->erase(thesis->get_cell());
-
-		if(!thesis->add_triggers(group, -digit, LVL_LOCATE, level_bits)){
+		if(!thesis->add_triggers(s->group(x,y,i).minus(thesis->get_cell()), -digit, LVL_LOCATE, level_bits))
       result = false;
-      delete group;
-    }
 	}
 	return result;
 }
@@ -500,26 +532,21 @@ bool locate(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
  */
 // if all possibilities of digit in groupA are also in groupB, then remove all
 // possiblities of digit in groupB that are not in groupA
-bool group_intersect(const set<solv_cell*>* groupA, const set<solv_cell*>* groupB, const int digit, solv_sudoku* s, const uint level_bits){
-
-  fp_node_set trigger_set;
-  set<solv_cell*> AminusB;
-  std::set_difference(groupA->begin(), groupA->end(), groupB->begin(), groupB->end(),
-        std::inserter(AminusB, AminusB.end()));
+bool group_intersect(const group_view<solv_cell>& groupA, const group_view<solv_cell>& groupB, const int digit, solv_sudoku* s, const uint level_bits){
 
-  set<solv_cell*> BminusA;
-  std::set_difference(groupB->begin(), groupB->end(), groupA->begin(), groupA->end(),
-        std::inserter(BminusA, BminusA.end()));
+  fp_node_list trigger_set;
+  const group_view<solv_cell> AminusB = groupA.minus(groupB);
+  const group_view<solv_cell> BminusA = groupB.minus(groupA);
  
   // triggered by all cells in groupA - groupB containing -digit
-  for(set<solv_cell*>::iterator i = AminusB.begin(); i != AminusB.end(); ++i){
+  for(group_view<solv_cell>::iterator i = AminusB.begin(); i != AminusB.end(); ++i){
     fp_node* node = (**i)[-digit];
     if(!node){
       dbgout << "impossible to trigger " << **i << "[" << -digit << "]!" << endl;
       return false;
     } else {
     dbgout << "adding " << *node << " to the trigger set" << endl;
-      trigger_set.insert(node);
+      trigger_set.push_back(node);
     }
   }
 
@@ -527,16 +554,11 @@ bool group_intersect(const set<solv_cell*>* groupA, const set<solv_cell*>* group
 
   // impact: noone in groupB - groupA can have digit
   bool result = false;
-  for(set<solv_cell*>::const_iterator i = BminusA.begin(); i != BminusA.end(); ++i){
+  for(group_view<solv_cell>::iterator i = BminusA.begin(); i != BminusA.end(); ++i){
     dbgout << "digit: " << digit << " result so far: " << result << endl;
-    fp_node_set* tmp_set = new fp_node_set(trigger_set);
-
     fp_node* node = (**i)[-digit];
-    if(node){
-      const bool tmp_result = node->add_trigger(tmp_set, LVL_GROUP, level_bits);
-      if(!tmp_result) delete tmp_set;
-      result |= tmp_result;
-    }
+    if(node)
+      result |= node->add_trigger(trigger_set, LVL_GROUP, level_bits);
   }
 
   return result;
@@ -546,22 +568,18 @@ bool group_intersect(const uint x, const uint y, const int digit, solv_sudoku* s
   if(!s) exit(1);
   if(digit < 0) return false;
 
-  set<solv_cell*> groupA, groupB;
- 
   // the rule makes only sence if one of the groups is a square
-  s->getsquare(x, y, &groupA);
-  s->getrow(x, y, &groupB);
+  const group_view<solv_cell> box = s->group(x, y, GROUP_BOX);
+  const group_view<solv_cell> row = s->group(x, y, GROUP_ROW);
+  const group_view<solv_cell> column = s->group(x, y, GROUP_COLUMN);
   
   bool result = false;
 
-  result |= group_intersect(&groupA, &groupB, digit, s, level_bits);
-  result |= group_intersect(&groupB, &groupA, digit, s, level_bits);
+  result |= group_intersect(box, row, digit, s, level_bits);
+  result |= group_intersect(row, box, digit, s, level_bits);
 
-  groupB.clear();
-  s->getcolumn(x, y, &groupB);
-
-  result |= group_intersect(&groupA, &groupB, digit, s, level_bits);
-  result |= group_intersect(&groupB, &groupA, digit, s, level_bits);
+  result |= group_intersect(box, column, digit, s, level_bits);
+  result |= group_intersect(column, box, digit, s, level_bits);
 
   return result;
 }
@@ -583,10 +601,10 @@ bool alignment(const uint x, const uint y, solv_sudoku* s, const uint level_bits
   uint num_digits = s->getnum_digits();
   for(uint group_nr = 0; group_nr < 3; ++group_nr){
     dbgout << "aligning group "<< group_nr << " at " << x << "," << y << endl;
-    solv_set* group = s->getgroup(x, y, group_nr);
+    const group_view<solv_cell> group = s->group(x, y, group_nr);
     
     dbgout << "aligning cells" << endl;
-    for(solv_set::iterator i = group->begin(); i != group->end(); ++i)
+    for(group_view<solv_cell>::iterator i = group.begin(); i != group.end(); ++i)
       result |= cell_align(group, *i, level_bits);
 
     dbgout << "aligning digits" << endl;
@@ -612,6 +630,29 @@ bool bigraph(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
 bool ebigraph(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
 	return tca(x,y,s,level_bits, 2);
 }
+
+// the same for all cells in one go [see fp_sweep]
+uint bigraph_all(solv_sudoku* s, const uint level_bits){
+	vector<uint> found;
+	fp_sweep sweep(&s->get_graph());
+	sweep.contradictions(level_bits, 1, found);
+	return trigger_opposites(s, found, level_bits);
+}
+bool bigraph_all(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
+	if(x || y) return false;
+	return bigraph_all(s, level_bits);
+}
+
+uint ebigraph_all(solv_sudoku* s, const uint level_bits){
+	vector<uint> found;
+	fp_sweep sweep(&s->get_graph());
+	sweep.contradictions(level_bits, 2, found);
+	return trigger_opposites(s, found, level_bits);
+}
+bool ebigraph_all(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
+	if(x || y) return false;
+	return ebigraph_all(s, level_bits);
+}
 /******** transitive chain analysis **********/
 /*
 # preamble: putting a digit in a certain cell means not putting
@@ -654,10 +695,11 @@ bool tca(const uint x, const uint y, solv_sudoku* s, const uint level_bits, cons
 
 	const uint digits = s->getnum_digits();
 	bool result = false;
+	fp_search search(&s->get_graph());
 
 	for(int i = -digits; i <= (int)digits; i++) if(i) if((*sc)[i]) if(!(*sc)[i]->is_triggered()){
     dbgout << *sc << ": trying to reach " << -i << " from " << i << endl;
-		if(fp_gap((*sc)[i], (*sc)[-i], level_bits, restrict_level)) {
+		if(search.gap((*sc)[i], (*sc)[-i], level_bits, restrict_level)) {
 			dbgout << "success: triggering " << *((*sc)[-i]) << endl;
 			result = true;
       (*sc)[-i]->set_trigger(level_bits);
@@ -670,4 +712,81 @@ bool tca(const uint x, const uint y, solv_sudoku* s, const uint level_bits, cons
 bool tca(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
 	return tca(x,y,s,level_bits,false);
 }
+
+// trigger the opposites of the given theses [leading to contradictions] of
+// empty cells, return how many there were
+uint trigger_opposites(solv_sudoku* s, vector<uint>& found, const uint level_bits){
+	// tca does not look at fixed cells
+	uint kept = 0;
+	for(uint i = 0; i < found.size(); i++)
+		if(!s->get_graph().node(found[i])->get_cell()->get_content()) found[kept++] = found[i];
+	found.resize(kept);
+
+	for(uint i = 0; i < found.size(); i++){
+		const fp_node* node = s->get_graph().node(found[i]);
+		solv_cell* sc = node->get_cell();
+		// an earlier one of the batch may have settled it
+		if(!s->get_graph().has_node(found[i])) continue;
+		if(node->is_triggered())
+			invalidwith("sudoku is invalid: " << *node << " holds and leads to a contradiction");
+		dbgout << "success: triggering " << *((*sc)[-node->get_thesis()]) << endl;
+		(*sc)[-node->get_thesis()]->set_trigger(level_bits);
+	}
+	return found.size();
+}
+
+// tca for all cells in one go [the same theses as tca() at every empty cell,
+// which must be tried one by one]
+uint tca_all(solv_sudoku* s, const uint level_bits){
+	vector<uint> found;
+	fp_search search(&s->get_graph());
+	search.contradictions(level_bits, found);
+	return trigger_opposites(s, found, level_bits);
+}
+
+// tca on threads threads, acting like the rule: the theses are searched in
+// the order of their literals [cell by cell] while the graph is left alone,
+// each thread with its own fp_search. Once one leads to a contradiction the
+// theses behind its cell are no longer searched, the cell of the first hit
+// gets all its hits applied and the agenda calls again for the next one.
+uint tca_parallel(solv_sudoku* s, const uint level_bits, const uint threads){
+	const fp_graph& graph = s->get_graph();
+	vector<uint> sources;
+	for(uint l = 0; l < graph.getnum_literals(); l++)
+		if(graph.has_node(l) && !graph.node(l)->is_triggered() && !graph.node(l)->get_cell()->get_content())
+			sources.push_back(l);
+
+	vector<fp_search> searches(threads ? threads : 1, fp_search(&graph));
+	vector<byte> hit(sources.size(), 0);
+	// index of the first hit so far [blocks are handed out in order, so
+	// anything behind it is left soon]
+	atomic<size_t> first(sources.size());
+	parallel_for(sources.size(), searches.size(), [&](const size_t begin, const size_t end, const uint thread){
+		for(size_t i = begin; (i < end) && (i < first.load()); i++){
+			if(!searches[thread].gap(graph.node(sources[i]), graph.node(sources[i] ^ 1), level_bits, 0)) continue;
+			hit[i] = 1;
+			size_t seen = first.load();
+			while((i < seen) && !first.compare_exchange_weak(seen, i));
+		}
+	}, 4);
+	if(first == sources.size()) return 0;
+
+	// everything before the first hit was searched, the rest of its cell
+	// may have been skipped
+	const solv_cell* cell = graph.node(sources[first])->get_cell();
+	vector<uint> found;
+	for(size_t i = first; (i < sources.size()) && (graph.node(sources[i])->get_cell() == cell); i++)
+		if(hit[i] || searches[0].gap(graph.node(sources[i]), graph.node(sources[i] ^ 1), level_bits, 0))
+			found.push_back(sources[i]);
+	return trigger_opposites(s, found, level_bits);
+}
+bool tca_parallel(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
+	if(x || y) return false;
+	return tca_parallel(s, level_bits, default_threads());
+}
+
+bool tca_all(const uint x, const uint y, solv_sudoku* s, const uint level_bits){
+	if(x || y) return false;
+	return tca_all(s, level_bits);
+}
 #endif
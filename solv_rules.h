@@ -21,6 +21,7 @@ Rules are:
 
 #include "fptree.h"
 #include "sudoku.h"
+#include "group_view.h"
 
 // each rule has a level specified here
 #define LVL_FLOOD     (1<<0)
@@ -31,6 +32,13 @@ Rules are:
 #define LVL_ALL       ((1<<6)-1)
 // returns if level x is allowed with level_bits y [or vice versa, its symmetric]
 #define level_allowed(x,y) ((x)&(y))
+// what a rule applied at a cell looks at [see solv_agenda]
+#define RULE_UNITS    0		// the theses of the units of the cell
+#define RULE_CELL     1		// the theses of the cell
+#define RULE_GRID     2		// the whole graph
+#define RULE_ONCE     3		// the whole graph, covered by one application at [0,0]
+#define RULE_STATIC   4		// once per cell: the triggers it adds follow every change
+#define RULE_GROUPS   5		// the units of the cell, each on its own [so one cell per unit will do]
 class solv_sudoku;
 
 class solv_rule {
@@ -38,11 +46,13 @@ private:
 	// location of the most recent application of this rule
 	uint lastx;
 	uint lasty;
+	uint scope;
 	bool (*apply_func)(const uint x, const uint y, solv_sudoku*, const uint);
 
 	bool __apply(const uint x, const uint y, solv_sudoku* s, const uint level_bits) const;
 public:
-	solv_rule(bool (*apply_f)(const uint x, const uint y, solv_sudoku*, const uint));
+	solv_rule(bool (*apply_f)(const uint x, const uint y, solv_sudoku*, const uint), const uint _scope = RULE_UNITS);
+	uint get_scope() const { return scope; }
 	// apply rule at a given location and return success [validity]
 	bool apply(const uint x, const uint y, solv_sudoku* s, const uint level_bits) const;
 	// find a suitable location and apply rule there, return whether the
@@ -54,17 +64,25 @@ public:
 // a sudoku_cell with constraint propagation capabilities
 class solv_cell{
 protected:
-	vector<fp_node*>* nodes;
+	fp_node** nodes;	// 2 * num_digits + 1 theses, in the arena
 	sudoku_cell* cell;
+	fp_graph* graph;	// of the solv_sudoku, holding the theses of the cell
   uint num_digits;
 
 	void sinit(const uint _num_digits);
 	bool remove_thesis(const int digit, const uint level_bits);
+	// take back remove_thesis() and set_content() [for rollbacks]
+	void restore_thesis(fp_node* node);
+	void restore_content(const uint digit);
 public:
-	solv_cell(const uint _num_digits, const uint _x, const uint _y, const uint _content = 0);
-	solv_cell(sudoku_cell* _cell);
+	solv_cell(sudoku_cell* _cell, fp_graph* _graph);
+	// the cell of _cell in a copy of the puzzle of model [_graph is the copy
+	// of the graph of model]
+	solv_cell(const solv_cell& model, sudoku_cell* _cell, fp_graph* _graph);
+	// shares the theses of _scell [for moving the sgrid only]
 	solv_cell(const solv_cell& _scell);
-	~solv_cell();
+	// the theses are freed with the arena of the graph
+	~solv_cell() {};
 	// something special: indices go from -num_digits to num_digits
 	// however: 0 is invalid
 	fp_node*& operator[](const int digit);
@@ -76,6 +94,7 @@ public:
 	uint get_y() const;
 	uint count_poss() const;
   uint getnum_digits() const;
+	uint get_index() const;
 
   friend bool operator<(const solv_cell& left, const solv_cell& right){
     return *(left.cell) < *(right.cell);
@@ -84,6 +103,7 @@ public:
     return os << *(s.cell);
   }
   friend class fp_node;
+  friend class fp_graph;
 
   operator int() const{
     return (int)(*cell);
@@ -93,18 +113,29 @@ public:
 typedef set<solv_cell*> solv_set;
 
 class solv_sudoku : public sudoku{
+	friend class solv_agenda;
 private:
-	vector<solv_cell*>* sgrid;
+	// all fp-trees of the puzzle [declared first, so it goes last]
+	fp_arena arena;
+	// the theses and triggers [in the arena, the tables shared with copies]
+	fp_graph* graph;
+	// one solv_cell per cell, laid out like the flat storage of the grid
+	vector<solv_cell> sgrid;
 
 	void solv_init(const uint level_bits);
+	// trigger the given digits of a puzzle [the sgrid must be fresh]
+	void set_givens(const corpus_entry& entry, const uint level_bits);
 	// add a NULL-check before adding to the group
 	//void ginsert(set<solv_cell*>* group, solv_cell* cell) const;
 public:
 	// constructor
 	solv_sudoku(const uint digits, const uint level_bits = LVL_ALL);
-	// constructor from file
+	// constructor from file [the first puzzle if it holds many]
 	solv_sudoku(const char* filename, const uint level_bits = LVL_ALL);
-	// copy constructor
+	// constructor from a puzzle of a corpus [see corpus.h]
+	solv_sudoku(const corpus_entry& entry, const uint level_bits = LVL_ALL);
+	// copy constructor [the copy shares the triggers with gs until one of
+	// them changes, so branching off a puzzle is cheap; gs must not be firing]
 	solv_sudoku(const solv_sudoku& gs);
 	// destructor
 	~solv_sudoku();
@@ -116,6 +147,8 @@ public:
 	void getcolumn(const uint x, solv_set* group) const;
 	// return a set of cells in the square n
 	void getsquare(const uint n, solv_set* group) const;
+	// return a set of cells in the unit with the given number [see geometry.h]
+	void getunit(const uint unit, solv_set* group) const;
 	// get the [row, col, square] (dependent on group_nr) of the cell at (x,y)
 	solv_set* getgroup(const uint x, const uint y, const uint group_nr) const;
 	// return a set of cells in the same row as cell (x,y)
@@ -126,12 +159,27 @@ public:
 	void getsquare(const uint x, const uint y, solv_set* group) const;
 	// get the n'th [row, col, square] (dependent on group_nr) 
 	solv_set* getgroup(const uint n, const uint group_nr) const;
+	// allocation free views of the groups [see group_view.h]
+	group_view<solv_cell> group(const uint x, const uint y, const uint group_nr) const;
+	group_view<solv_cell> group(const uint n, const uint group_nr) const;
+	group_list<solv_cell> groups(const uint x, const uint y) const;
+	group_view<solv_cell> peers(const uint x, const uint y) const;
 	// apply a rule to a certain cell of the sudoku, return success [validity]
 	bool applyrule(const uint x, const uint y, solv_rule* r, const uint level_bits);
 	// apply a rule to a suitable cell in the sudoku, return success
 	bool applyrule(solv_rule* r, const uint level_bits);
 	// get "neg(thesis)"
 	fp_node* get_opposite(const fp_node* thesis);
+	// the memory of the fp-trees
+	const fp_arena& get_arena() const;
+	const fp_graph& get_graph() const;
+	// try something and take it back: all changes to the grid and the
+	// fp-graph after checkpoint() are undone by rollback(mark) [in time
+	// proportional to the changes] or kept by commit(mark); checkpoints
+	// nest and must be closed in reverse order
+	size_t checkpoint();
+	void rollback(const size_t mark);
+	void commit(const size_t mark);
 };
 
 
@@ -155,10 +203,30 @@ bool alignment(const uint x, const uint y, solv_sudoku* s, const uint level_bits
 
 bool tca(const uint x, const uint y, solv_sudoku* s, const uint level_bits, const uint restrict_level);
 bool tca(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
+// trigger the opposites of the given theses [leading to contradictions] of
+// empty cells, return how many there were
+uint trigger_opposites(solv_sudoku* s, vector<uint>& found, const uint level_bits);
+// tca for all cells in one go: finds every thesis leading to a contradiction
+// [see fp_search::contradictions()] and triggers all their opposites, returns
+// how many it found
+uint tca_all(solv_sudoku* s, const uint level_bits);
+// the same as a rule [it covers the whole grid, so it acts at [0,0] only]
+bool tca_all(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
+// tca with fp_gap() on threads threads: searches the theses cell by cell
+// like the rule, stops at the first cell with a contradiction and triggers
+// its opposites there, returns how many [0 if no cell had any]
+uint tca_parallel(solv_sudoku* s, const uint level_bits, const uint threads);
+bool tca_parallel(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
 
 
 bool bigraph(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
 bool ebigraph(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
+// bigraph and ebigraph for all cells in one go [see fp_sweep], return how
+// many theses they found
+uint bigraph_all(solv_sudoku* s, const uint level_bits);
+bool bigraph_all(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
+uint ebigraph_all(solv_sudoku* s, const uint level_bits);
+bool ebigraph_all(const uint x, const uint y, solv_sudoku* s, const uint level_bits);
 
 /******** transitive chain analysis **********/
 /*
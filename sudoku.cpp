@@ -7,80 +7,64 @@
 #define sudoku_cpp
 
 #include "sudoku.h"
+#include "geometry.h"
+#include "group_view.h"
+#include "grid_core.h"
+#include "sudoku_io.h"
+#include "corpus.h"
+#include "canonical.h"
 
-void sudoku_cell::init(const uint _num_digits, const uint _x, const uint _y, const uint _content){
-	x = _x; 
-	y = _y;
-	num_digits = _num_digits;
-	content = _content;
-}
-	
 // constructor
-sudoku_cell::sudoku_cell(const uint _num_digits, const uint _x, const uint _y, const uint _content){
-	init(_num_digits, _x, _y, _content);
+sudoku_cell::sudoku_cell(sudoku* _owner, const uint _index):owner(_owner),index(_index){
 }
 // copy constructor
-sudoku_cell::sudoku_cell(const sudoku_cell& cell){
-	init(cell.num_digits, cell.x, cell.y, cell.content);
+sudoku_cell::sudoku_cell(const sudoku_cell& cell):owner(cell.owner),index(cell.index){
 }
 // destructor
 sudoku_cell::~sudoku_cell(){
 }	
-// user interface
-uint sudoku_cell::get_content() const{
-	return content;
-}
-
-void sudoku_cell::set_content(const uint _content){
-	content = _content;
-}
 void sudoku_cell::remove_content(){
 	set_content(0);
 }
-uint sudoku_cell::get_num_digits()const{
-	return num_digits;
-}
-uint sudoku_cell::get_x() const{
-	return x;
-}
-uint sudoku_cell::get_y() const{
-	return y;
-}
 
-uint sudoku::get_index(const uint x, const uint y) const{
-	return y * num_digits + x;
-}
-void sudoku::init(const uint digits, const vector<sudoku_cell*>* copy_grid){
+// allocate the flat storage and bind one view per cell to it
+void sudoku::init(const uint digits){
+	const uint num_cells = digits * digits;
 	num_digits = digits;
-	grid = new vector<sudoku_cell*>(num_digits * num_digits);
-	for(uint i = 0; i < digits; i++)
-		for(uint j = 0; j < digits; j++)
-			if(copy_grid)
-				(*grid)[get_index(i,j)] = new sudoku_cell(*((*copy_grid)[get_index(i,j)]));
-			else 
-				(*grid)[get_index(i,j)] = new sudoku_cell(digits, i, j, 0);
+	geometry = sudoku_geometry::get(digits);
+	kernels = grid_kernels::get(digits);
+
+	content.assign(num_cells, 0);
+	candidates.assign(num_cells, all_digits());
+	// the empty grid hashes to 0 [see hash_mix()]
+	hash = 0;
+	relabel_hash = 0;
+	digit_keys.assign(digits + 1, 0);
+	zobrist_keys = &geometry->zobrist_keys[0];
+	cell_keys = &geometry->cell_keys[0];
+	cells.clear();
+	cells.reserve(num_cells);
+	for(uint i = 0; i < num_cells; ++i)
+		cells.push_back(sudoku_cell(this, i));
 }
 
-char* sudoku::read_first_line(const char* filename){
-	FILE* f;
-	bool is_file = false;
-	
-  dbgout << "trying to open \"" << filename << "\"" << endl;
-	if(!strcmp(filename,"stdin")) f = stdin; else {
-		f = fopen(filename, "ro");
-		is_file = true;
-		if(!f) diewith("error opening \"" << filename << "\"" << endl);
+// recompute the hashes after writing content directly
+void sudoku::rehash(){
+	hash = 0;
+	relabel_hash = 0;
+	digit_keys.assign(num_digits + 1, 0);
+	for(uint i = 0; i < num_digits * num_digits; ++i){
+		hash ^= zobrist_keys[i * (num_digits + 1) + content[i]];
+		if(content[i]) digit_keys[content[i]] ^= cell_keys[i];
 	}
-	char* s = (char*)malloc(MAX_DIGITS + 1);
-	if(!fscanf(f, "%s", s)) diewith("error reading \"" << filename << "\": bad format" << endl);
-	if(is_file) fclose(f);
-	return s;
+	for(uint digit = 1; digit <= num_digits; ++digit)
+		relabel_hash += hash_mix(digit_keys[digit]);
 }
 
 void sudoku::mem_free(){
-	for(uint i = 0; i < num_digits * num_digits; i++)
-		delete (*grid)[i];
-	delete grid;
+	content.clear();
+	candidates.clear();
+	cells.clear();
 }
 
 
@@ -90,28 +74,52 @@ sudoku::sudoku(const uint digits){
 }
 // construct from a file
 sudoku::sudoku(const char* filename, const bool read_field){
-	char* s = read_first_line(filename);
+	corpus_reader reader(filename);
+	if(!reader.is_open()) diewith("error opening \"" << filename << "\"" << endl);
+	corpus_entry entry;
+	if(!reader.next(entry)) diewith("error reading \"" << filename << "\": bad format" << endl);
 
-	init(strlen(s));
+	init(entry.num_digits);
 	dbgout << "number of digits: " << num_digits << endl;
 	
-	if(read_field) read_from_file(filename, strcmp(filename,"stdin")?NULL:s);
-	free(s);
+	if(read_field) read_entry(entry);
+}
+// construct from a puzzle of a corpus
+sudoku::sudoku(const corpus_entry& entry){
+	init(entry.num_digits);
+	read_entry(entry);
 }
 
 // copy constructor
 sudoku::sudoku(const sudoku& s){
-	init(s.num_digits, s.grid);
+	init(s.num_digits);
+	content = s.content;
+	candidates = s.candidates;
+	hash = s.hash;
+	relabel_hash = s.relabel_hash;
+	digit_keys = s.digit_keys;
 }
 // destructor
 sudoku::~sudoku(){
 	mem_free();
 }
-// write a cell to a position in the grid
+// assignment [rebinds the cell views to this grid]
+sudoku& sudoku::operator=(const sudoku& s){
+	if(this != &s){
+		init(s.num_digits);
+		content = s.content;
+		candidates = s.candidates;
+		hash = s.hash;
+		relabel_hash = s.relabel_hash;
+		digit_keys = s.digit_keys;
+	}
+	return *this;
+}
+// copy the content of a cell to a position in the grid
 bool sudoku::put_cell(const uint x, const uint y, sudoku_cell* cell){
-	if((x < num_digits) && (y < num_digits)){
-		delete (*grid)[y * num_digits + x];
-		(*grid)[y * num_digits + x] = cell;
+	if((x < num_digits) && (y < num_digits) && cell){
+		set_content(get_index(x, y), cell->get_content());
+		set_candidates(get_index(x, y), cell->get_candidates());
 	} else return false;
 	return true;
 }
@@ -119,43 +127,43 @@ bool sudoku::put_cell(const uint x, const uint y, sudoku_cell* cell){
 // read a cell from a position in the grid
 sudoku_cell* sudoku::get_cell(const uint x, const uint y) const{
 	if((x < num_digits) && (y < num_digits))
-		return (*grid)[y * num_digits +x];
+		return cell_at(get_index(x, y));
 	else return NULL;
 }
 
-// return the squared order [ = how many different digits there are]
-uint sudoku::getnum_digits() const{
-	return num_digits;
+// overwrite the contents of all cells
+void sudoku::set_contents(const byte* digits){
+	for(uint i = 0; i < num_digits * num_digits; ++i)
+		set_content(i, digits[i]);
+}
+
+// return the order [ = the side length of a box]
+uint sudoku::get_order() const{
+	return geometry->order;
 }
 
 // return a set of cells in row y
 void sudoku::getrow(const uint y, set<sudoku_cell*>* group) const{
-	for(uint i = 0; i < num_digits; i++)
-		group->insert((*grid)[get_index(i,y)]);
+	getunit(geometry->unit(GROUP_ROW, y), group);
 }
 // return a set of cells in the column x
 void sudoku::getcolumn(const uint x, set<sudoku_cell*>* group) const{
-	for(uint i = 0; i < num_digits; i++)
-		group->insert((*grid)[get_index(x,i)]);
+	getunit(geometry->unit(GROUP_COLUMN, x), group);
 }
 // return a set of cells in the square n
 void sudoku::getsquare(const uint n, set<sudoku_cell*>* group) const{
-	uint order = (uint)sqrt((double)num_digits);
-	uint sq_x = n % order;
-	uint sq_y = n / order;
-	for(uint i = 0; i < order; i++)
-		for(uint j = 0; j < order; j++)
-			group->insert((*grid)[get_index(order * sq_x + i, order * sq_y + j)]);
+	getunit(geometry->unit(GROUP_BOX, n), group);
+}
+// return a set of cells in the unit with the given number [see geometry.h]
+void sudoku::getunit(const uint unit, set<sudoku_cell*>* group) const{
+	for(const uint* i = geometry->unit_begin(unit); i != geometry->unit_end(unit); ++i)
+		group->insert(cell_at(*i));
 }
 
 // get the n'th [row, col, square] (dependent on group_nr) 
 set<sudoku_cell*>* sudoku::getgroup(const uint n, const uint group_nr) const {
 	set<sudoku_cell*>* group = new set<sudoku_cell*>();
-	switch(group_nr){
-		case 0: getrow(n, group); break;
-		case 1: getcolumn(n, group); break;
-		case 2: getsquare(n, group); break;
-	}
+	if(group_nr < 3) getunit(geometry->unit(group_nr, n), group);
 	return group;
 }
 
@@ -163,13 +171,23 @@ set<sudoku_cell*>* sudoku::getgroup(const uint n, const uint group_nr) const {
 // get the [row, col, square] (dependent on group_nr) of the cell at (x,y)
 set<sudoku_cell*>* sudoku::getgroup(const uint x, const uint y, const uint group_nr) const {
 	set<sudoku_cell*>* group = new set<sudoku_cell*>();
-	switch(group_nr){
-		case 0: getrow(x,y, group); break;
-		case 1: getcolumn(x,y, group); break;
-		case 2: getsquare(x,y, group); break;
-	}
+	if(group_nr < 3) getunit(geometry->unit_of(get_index(x, y), group_nr), group);
 	return group;
 }
+// allocation free views of the groups [see group_view.h]
+group_view<sudoku_cell> sudoku::group(const uint x, const uint y, const uint group_nr) const{
+	return group_view<sudoku_cell>::unit(cell_at(0), geometry, geometry->unit_of(get_index(x, y), group_nr));
+}
+group_view<sudoku_cell> sudoku::group(const uint n, const uint group_nr) const{
+	return group_view<sudoku_cell>::unit(cell_at(0), geometry, geometry->unit(group_nr, n));
+}
+group_list<sudoku_cell> sudoku::groups(const uint x, const uint y) const{
+	return group_list<sudoku_cell>(cell_at(0), geometry, get_index(x, y));
+}
+group_view<sudoku_cell> sudoku::peers(const uint x, const uint y) const{
+	return group_view<sudoku_cell>::peers(cell_at(0), geometry, get_index(x, y));
+}
+
 // return a set of cells in the same row as cell (x,y)
 void sudoku::getrow(const uint x, const uint y, set<sudoku_cell*>* group) const{
 	getrow(y,group);
@@ -180,129 +198,136 @@ void sudoku::getcolumn(const uint x, const uint y, set<sudoku_cell*>* group) con
 }
 // return a set of cells in the same square as cell (x,y)
 void sudoku::getsquare(const uint x, const uint y, set<sudoku_cell*>* group) const{
-	uint order = (uint)sqrt((double)num_digits);
-	uint sq_x = x / order;
-	uint sq_y = y / order;
-	getsquare(sq_y * order + sq_x, group);
-}
-// read a sudoku field from a given file with the first line provided in first
-void sudoku::read_from_file(const char* filename, const char* first){
-	FILE* f;
-	bool is_file = false;
-	if(!strcmp(filename,"stdin")) f = stdin; else {
-		f = fopen(filename, "ro");
-		is_file = true;
-	}
+	getsquare(geometry->cell_box[get_index(x, y)], group);
+}
+// read a sudoku field from a given file [the first puzzle if it holds many]
+void sudoku::read_from_file(const char* filename){
 	dbgout << "reading sudoku data from \"" << filename << "\"" << endl;
-	if(!f) diewith("error opening \""<< filename <<"\"" << endl);
-	
-	uint digits[num_digits][num_digits];
-	unsigned char* buffer = (unsigned char*)malloc(num_digits + 1); // insecure, may cause segfault
-	for(uint row = 0; row < num_digits; ++row){
-		if(first && !row){
-      strcpy((char*)buffer, first);
-    }else{
-      if(!fscanf(f, "%s", (char*)buffer))
-        diewith("error reading from \"" << filename << "\"" << endl);
-    }
-		dbgout << "read \"" << buffer << "\" from \"" << filename << "\"" << endl;
-		if(strlen((char*)buffer) < num_digits){
-      diewith("error reading \"" << filename << "\": not enough digits in row" << row << endl);
-    } else {
-				for(uint col = 0; col < num_digits; ++col){
-          if((buffer[col] < '0') || (buffer[col] > '0'+num_digits))
-            digits[col][row] = 0;
-          else digits[col][row] = buffer[col] - '0';
-        }
-		}
-	}
-	if(is_file) fclose(f);
-	free(buffer);
-
-	for(uint col = 0; col < num_digits; ++col)
-		for(uint row = 0; row < num_digits; ++row){
-			(*grid)[get_index(col, row)]->set_content(digits[col][row]);
-		}
+	corpus_reader reader(filename);
+	if(!reader.is_open()) diewith("error opening \""<< filename <<"\"" << endl);
+	corpus_entry entry;
+	if(!reader.next(entry)) diewith("error reading \"" << filename << "\": bad format" << endl);
+	if(entry.num_digits != num_digits)
+		diewith("error reading \"" << filename << "\": expected rows of " << num_digits << " digits" << endl);
+	read_entry(entry);
+}
+// read a sudoku field from a puzzle of a corpus
+void sudoku::read_entry(const corpus_entry& entry){
+	if((entry.num_digits != num_digits) || !entry.parse(&content[0]))
+		diewith("error reading puzzle " << entry.number << ": not enough digits" << endl);
+	rehash();
 }
 
 // output the grid to the stardard output stream
 void sudoku::print() const{
-  uint zeroes = 0;
-	for(uint j = 0; j < num_digits; j++){
-		for(uint i = 0; i < num_digits; i++){
-			cout << (char)('0' + get_cell(i,j)->get_content());
-      if(!get_cell(i,j)->get_content()) ++zeroes;
-    }
-    cout << endl;
-	}
-  cout << zeroes << " empty cells" << endl;
+	string out;
+	format_grid(&content[0], num_digits, out);
+	cout << out << count_empty() << " empty cells" << endl;
 }
 
 bool sudoku::is_valid() const{
-	set<sudoku_cell*>* group;
-	bool bitfield[num_digits];
-	bool result = true;
-	for(uint group_nr = 0; group_nr < 3; group_nr++){
-		for(uint i = 0; i < num_digits; i++){
-			group = getgroup(i, group_nr);
-			for(uint i = 0; i < num_digits; i++)
-				bitfield[i] = false;
-			for(set<sudoku_cell*>::iterator j = group->begin(); j != group->end(); j++)
-				bitfield[(*j)->get_content() - 1] = true;
-			delete group;
-			for(uint i = 0; i < num_digits; i++)
-				if(!bitfield[i]) return false;
-		}
-	}
-	return result;
+	return kernels->is_valid(&content[0]);
+}
+bool sudoku::is_consistent() const{
+	return kernels->is_consistent(&content[0]);
+}
+uint sudoku::count_empty() const{
+	return kernels->count_empty(&content[0]);
+}
+void sudoku::compute_candidates(){
+	kernels->candidates(&content[0], &candidates[0]);
 }
 
-// equality on several levels [see above]
-bool sudoku::is_equal(const sudoku& s, const uint levels) const{
-	// check for permuted digits
-	//EQ_PERMUTE_DIGITS
-	uint x,y;
-	bool result = false;
-	if(!result && (levels & EQ_PERMUTE_DIGITS)){
-		uint *perm = new uint[num_digits];
-		uint content;
-		for(uint i = 0; i < num_digits; i++) perm[i] = 0;
-		x=y=0;	result = true;
-		while((y < num_digits) && result){
-			content = s.get_cell(x,y)->get_content();
-			if(content){
-				content--;
-				if(perm[content] == 0)
-					perm[content] = get_cell(x,y)->get_content();
-				else 
-					if(perm[content] != get_cell(x,y)->get_content()) result = false;
-			} else
-				if(get_cell(x,y)->get_content()) result = false;
-			x++;
-			if(x == num_digits) { x=0; y++;}
-		}
-		delete perm;
+// the 8 rotations and flips of the square: transpose first if bit 0 is set,
+// then mirror x if bit 1 is set and mirror y if bit 2 is set
+static void square_map(const uint code, const uint x, const uint y, const uint n, uint& rx, uint& ry){
+	rx = (code & 1) ? y : x;
+	ry = (code & 1) ? x : y;
+	if(code & 2) rx = n - 1 - rx;
+	if(code & 4) ry = n - 1 - ry;
+}
+// the code of the symmetry doing first a, then b [found by following two
+// corners of a 2x2 square, which is enough to tell the 8 symmetries apart]
+static uint square_compose(const uint a, const uint b){
+	uint corner[2][2];
+	for(uint p = 0; p < 2; ++p){
+		uint ax, ay;
+		square_map(a, p, 0, 2, ax, ay);
+		square_map(b, ax, ay, 2, corner[p][0], corner[p][1]);
 	}
-	//EQ_ROTATE
-	if(!result && (levels & EQ_ROTATE)){
-		for(uint i = 1; i < 4; i++){
+	for(uint code = 0; code < 8; ++code){
+		bool same = true;
+		for(uint p = 0; p < 2; ++p){
+			uint cx, cy;
+			square_map(code, p, 0, 2, cx, cy);
+			same = same && (cx == corner[p][0]) && (cy == corner[p][1]);
 		}
+		if(same) return code;
 	}
-	//EQ_FLIP
-	if(!result && (levels & EQ_FLIP)){
+	return 0;
+}
+// bit i is set iff rotation/flip i is generated by the levels
+static uint square_symmetries(const uint levels){
+	uint generators = 0;
+	if(levels & EQ_ROTATE) generators |= 1 << 3;	// rotate by 90: transpose, then mirror x
+	if(levels & EQ_FLIP) generators |= (1 << 2) | (1 << 4);
+	if(levels & EQ_TRANSPOSE) generators |= 1 << 1;
+	uint result = 1;
+	for(bool grown = true; grown; ){
+		grown = false;
+		for(uint a = 0; a < 8; ++a)
+			for(uint b = 0; b < 8; ++b)
+				if((result & (1 << a)) && (generators & (1 << b)) && !(result & (1 << square_compose(a, b)))){
+					result |= 1 << square_compose(a, b);
+					grown = true;
+				}
 	}
-	//EQ_TRANSPOSE
-	if(!result && (levels & EQ_TRANSPOSE)){
-		x=y=0; result = true;
-		while((y < num_digits) && result){
-			if(s.get_cell(x,y)->get_content() != get_cell(y,x)->get_content()) result = false;
-			x++;
-			if(x == num_digits) { x=0; y++;}
-		}
+	return result;
+}
+
+// equality up to the symmetries given by levels
+bool sudoku::is_equal(const sudoku& s, const uint levels) const{
+	if(s.num_digits != num_digits) return false;
+	// the hashes tell most unequal grids apart right away
+	if(!levels && (s.hash != hash)) return false;
+	if((levels == EQ_PERMUTE_DIGITS) && (s.relabel_hash != relabel_hash)) return false;
+	const uint num_cells = num_digits * num_digits;
+
+	// line permutations include all flips, so only transposition is left
+	if(levels & EQ_PERMUTE_LINES){
+		const uint symmetries = ((levels & (EQ_ROTATE | EQ_TRANSPOSE)) ? CANON_TRANSPOSE : 0) |
+			((levels & EQ_PERMUTE_DIGITS) ? CANON_RELABEL : 0);
+		vector<byte> mine(num_cells), other(num_cells);
+		canonical_form(&content[0], num_digits, &mine[0], NULL, symmetries);
+		canonical_form(&s.content[0], num_digits, &other[0], NULL, symmetries);
+		return mine == other;
 	}
 
-#warning continue here!
-	return result;
+	const uint symmetries = square_symmetries(levels);
+	vector<byte> perm(num_digits + 1), inverse(num_digits + 1);
+	for(uint code = 0; code < 8; ++code){
+		if(!(symmetries & (1 << code))) continue;
+		// digit d of s must always meet the same digit perm[d] here and vice versa
+		fill(perm.begin(), perm.end(), 0);
+		fill(inverse.begin(), inverse.end(), 0);
+		bool result = true;
+		for(uint y = 0; result && (y < num_digits); ++y)
+			for(uint x = 0; result && (x < num_digits); ++x){
+				uint mx, my;
+				square_map(code, x, y, num_digits, mx, my);
+				const byte theirs = s.content[get_index(x, y)];
+				const byte mine = content[get_index(mx, my)];
+				if(!(levels & EQ_PERMUTE_DIGITS) || !theirs || !mine)
+					result = (theirs == mine);
+				else if(!perm[theirs] && !inverse[mine]){
+					perm[theirs] = mine;
+					inverse[mine] = theirs;
+				} else
+					result = (perm[theirs] == mine);
+			}
+		if(result) return true;
+	}
+	return false;
 }
 
 bool sudoku::operator==(const sudoku& s) const{
@@ -310,42 +335,34 @@ bool sudoku::operator==(const sudoku& s) const{
 }
 
 ostream& operator<<(ostream& os, const sudoku& s){
-	for(uint i = 0; i < s.num_digits; i++){
-		for(uint j = 0; j < s.num_digits; j++)
-			os << (*s.grid)[s.get_index(i, j)]->get_content();
-		os << "\n";
-	}
-	return os;
+	string out;
+	format_grid(&s.content[0], s.num_digits, out);
+	return os << out;
 }
 
+// read rows until the grid whose size is given by the first row is complete
 istream& operator>>(istream& is, sudoku& s){
-		uint* digits = NULL;
-		char* str = (char*)malloc(MAX_DIGITS + 1); // insecure, may cause segfault
-		uint num_digits = 1;
+	string text;
+	string line;
+	uint num_digits = 0;
+	uint rows = 0;
 
-		for(uint y = 0; y < num_digits; y++){
-			is >> str;
-			dbgout << "read " << str << " from the stream" << endl;
-			if(!y) {
-				num_digits = strlen(str);
-				dbgout << "getting " << sizeof(uint) * num_digits * num_digits << " bytes for digits"<<endl;
-				digits = (uint*)malloc(sizeof(uint) * num_digits * num_digits);
-			}
-			if(strlen(str) < num_digits){
-        diewith("error reading stream: not enough digits in a row" << endl);
-			} else {
-				for(int x = 0; x < (int)num_digits; x++)
-					digits[s.get_index(x,y)] = str[x] - '0';
-			}
-		}
-		free(str);
+	while(((!num_digits) || (rows < num_digits)) && getline(is, line)){
+		dbgout << "read " << line << " from the stream" << endl;
+		const uint digits = grid_digits(line.data(), line.data() + line.size());
+		if(!digits) continue;
+		if(!num_digits) num_digits = digits;
+		text += line;
+		text += '\n';
+		++rows;
+	}
+	if(!num_digits) return is;
 
-		s.mem_free();
-		s.init(num_digits);
-		
-		for(uint x = 0; x < num_digits * num_digits; x++)
-			((*s.grid)[x])->set_content(digits[x]);
-		free(digits);
+	s.mem_free();
+	s.init(num_digits);
+	if(!parse_grid(text.data(), text.data() + text.size(), num_digits, &s.content[0]))
+		diewith("error reading stream: not enough digits in a row" << endl);
+	s.rehash();
 	return is;
 }
 
@@ -9,16 +9,20 @@
 #include <math.h>
 #include <iostream>
 #include <set>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 
 #define DEBUG 0
-#define MAX_DIGITS 1024
 #define dbgout if(DEBUG) cout
 #define dbgprint if(DEBUG) printf
 #define diewith(x)  {cout<< x; exit(1);}
+// a puzzle without a solution [or one that cannot be read] is thrown, so
+// whoever solves many of them can go on with the next one
+#define invalidwith(x)  {ostringstream what; what<< x; throw invalid_sudoku(what.str());}
 #define uint unsigned int
 #define byte unsigned char
 
@@ -26,32 +30,56 @@
 #define EQ_ROTATE			2
 #define EQ_FLIP				4
 #define EQ_TRANSPOSE		8
+// rows inside a band, bands, columns inside a stack and stacks
+#define EQ_PERMUTE_LINES	16
 
-#define EQ_NONGEOMETRIC		EQ_PERMUTE_DIGITS
-#define EQ_GEOMETRIC		EQ_ROTATE | EQ_FLIP | EQ_TRANSPOSE
-#define EQ_ALL				EQ_GEOMETRIC | EQ_NONGEOMETRIC
+#define EQ_NONGEOMETRIC		(EQ_PERMUTE_DIGITS)
+#define EQ_GEOMETRIC		(EQ_ROTATE | EQ_FLIP | EQ_TRANSPOSE | EQ_PERMUTE_LINES)
+#define EQ_ALL				(EQ_GEOMETRIC | EQ_NONGEOMETRIC)
 
 using namespace std;
 
+class invalid_sudoku : public runtime_error{
+public:
+	invalid_sudoku(const string& what):runtime_error(what){}
+};
+
 class sudoku;
+class sudoku_geometry;
+struct grid_kernels;
+template<class Cell> class group_view;
+template<class Cell> class group_list;
+struct corpus_entry;
 
 // rules wrapper class
 // pass an object of this class to sudoku::applyrule() to
 // apply the rule to a sudoku
 class vtree_node;
 
+// candidate bitmask of a cell: bit (d-1) is set iff digit d is still possible
+typedef unsigned long long digit_mask;
+#define MASK_DIGITS 64
+
+// a bijective 64-bit mixer [the murmur3 finalizer, hash_mix(0) = 0]
+inline unsigned long long hash_mix(unsigned long long x){
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ull;
+	return x ^ (x >> 33);
+}
+
+// a sudoku_cell is a thin view into the flat storage of its sudoku grid,
+// it holds no data of its own except its position
 class sudoku_cell{
 protected:
-	uint num_digits;
-	uint content;
-	uint x;
-	uint y;
+	sudoku* owner;
+	uint index;
 
-	void init(const uint _num_digits, const uint _content, const uint _x, const uint _y);
 public:
 	// constructor
-	sudoku_cell(const uint _num_digits, const uint _x, const uint _y, const uint _content = 0);
-	// copy constructor
+	sudoku_cell(sudoku* _owner, const uint _index);
+	// copy constructor [copies the view, not the content]
 	sudoku_cell(const sudoku_cell& cell);
 	// destructor
 	~sudoku_cell();
@@ -62,13 +90,16 @@ public:
 	uint get_num_digits()const;
 	uint get_x() const;
 	uint get_y() const;
+	uint get_index() const;
+	digit_mask get_candidates() const;
+	void set_candidates(const digit_mask mask);
  
   operator int() const {
-    return y * num_digits + x;
+    return index;
   }
   friend ostream& operator<<(ostream& os, const sudoku_cell& s){
-    os << "(" << s.x << "," << s.y << ")";
-    if(s.content) os << "[" << s.content << "]";
+    os << "(" << s.get_x() << "," << s.get_y() << ")";
+    if(s.get_content()) os << "[" << s.get_content() << "]";
     return os;
   }
 };
@@ -76,35 +107,82 @@ public:
 class sudoku {
 protected:
 	uint num_digits;
-	vector<sudoku_cell*>* grid;
+	// unit and peer tables shared by all grids of this order
+	const sudoku_geometry* geometry;
+	// loops over the grid, compiled for this order [see grid_core.h]
+	const grid_kernels* kernels;
+	// flat, row-major cell storage; cell (x,y) lives at index y * num_digits + x
+	vector<byte> content;			// 0 means "empty"
+	vector<digit_mask> candidates;	// digits not [yet] excluded for the cell
+	vector<sudoku_cell> cells;		// views handed out by get_cell()
+	// hashes of the content, kept up to date by set_content():
+	// hash is the XOR of the Zobrist keys of all (cell, content) pairs,
+	// relabel_hash is the sum of hash_mix(digit_keys[d]) over all digits d,
+	// digit_keys[d] being the XOR of the keys of the cells containing d
+	unsigned long long hash;
+	unsigned long long relabel_hash;
+	vector<unsigned long long> digit_keys;
+	const unsigned long long* zobrist_keys;	// the tables of the geometry
+	const unsigned long long* cell_keys;
 
 	uint get_index(const uint x, const uint y) const;
-	void init(const uint digits, const vector<sudoku_cell*>* copy_grid = NULL);
-	char* read_first_line(const char* filename);
+	// recompute the hashes after writing content directly
+	void rehash();
+	// move a cell key into or out of digit_keys[digit]
+	void toggle_digit_key(const uint digit, const unsigned long long key);
+	// the view of the cell with a given index
+	sudoku_cell* cell_at(const uint index) const;
+	void init(const uint digits);
 	void mem_free();
 
 public:
-	sudoku() {};
+	sudoku():num_digits(0),geometry(NULL),kernels(NULL),hash(0),relabel_hash(0),zobrist_keys(NULL),cell_keys(NULL) {};
 	// constructor
 	sudoku(const uint digits);
-	// construct from a file
+	// construct from a file [the first puzzle of a corpus, see corpus.h]
 	sudoku(const char* filename, const bool read_field = true);
+	// construct from a puzzle of a corpus
+	sudoku(const corpus_entry& entry);
 	// copy constructor
 	sudoku(const sudoku& s);
 	// destructor
 	~sudoku();
-	// write a cell to a position in the grid
+	// assignment [rebinds the cell views to this grid]
+	sudoku& operator=(const sudoku& s);
+	// copy the content of a cell to a position in the grid
 	bool put_cell(const uint x, const uint y, sudoku_cell* cell);
 	// read a cell from a position in the grid
 	sudoku_cell* get_cell(const uint x, const uint y) const;
 	// return the squared order [ = how many different digits there are]
 	uint getnum_digits() const;
+	// return the order [ = the side length of a box]
+	uint get_order() const;
+	// return the unit and peer tables of this grid
+	const sudoku_geometry* get_geometry() const;
+	// direct access to the flat storage by cell index [see get_index()]
+	uint get_content(const uint index) const;
+	void set_content(const uint index, const uint digit);
+	digit_mask get_candidates(const uint index) const;
+	void set_candidates(const uint index, const digit_mask mask);
+	// the mask containing all digits of this grid
+	digit_mask all_digits() const;
+	// the contents of all cells [row-major, num_digits * num_digits entries]
+	const byte* get_contents() const;
+	void set_contents(const byte* digits);
+	// 64-bit hash of the content, updated on every change [equal grids have
+	// equal hashes]
+	unsigned long long get_hash() const;
+	// the same, but equal for grids differing only by a relabeling of the
+	// digits [see EQ_PERMUTE_DIGITS]
+	unsigned long long get_relabel_hash() const;
 	// return a set of cells in row x
 	void getrow(const uint x, set<sudoku_cell*>* group) const;
 	// return a set of cells in the column y
 	void getcolumn(const uint y, set<sudoku_cell*>* group) const;
 	// return a set of cells in the square n
 	void getsquare(const uint n, set<sudoku_cell*>* group) const;
+	// return a set of cells in the unit with the given number [see geometry.h]
+	void getunit(const uint unit, set<sudoku_cell*>* group) const;
 	// get the [row, col, square] (dependent on group_nr) of the cell at (x,y)
 	set<sudoku_cell*>* getgroup(const uint x, const uint y, const uint group_nr) const;
 	// return a set of cells in the same row as cell (x,y)
@@ -115,18 +193,107 @@ public:
 	void getsquare(const uint x, const uint y, set<sudoku_cell*>* group) const;
 	// get the n'th [row, col, square] (dependent on group_nr) 
 	set<sudoku_cell*>* getgroup(const uint n, const uint group_nr) const;
-	// read a sudoku field from a given file with the first line provided in first
-	void read_from_file(const char* filename, const char* first = NULL);
+	// allocation free views of the groups [see group_view.h]
+	group_view<sudoku_cell> group(const uint x, const uint y, const uint group_nr) const;
+	group_view<sudoku_cell> group(const uint n, const uint group_nr) const;
+	group_list<sudoku_cell> groups(const uint x, const uint y) const;
+	group_view<sudoku_cell> peers(const uint x, const uint y) const;
+	// read a sudoku field from a given file [the first puzzle if it holds many]
+	void read_from_file(const char* filename);
+	// read a sudoku field from a puzzle of a corpus
+	void read_entry(const corpus_entry& entry);
 	// output the grid to the stardard output stream
 	void print()const;
+	// true iff the grid is completely and correctly filled
 	bool is_valid()const;
-	// equality ono several levels [see above]
+	// true iff no unit contains a digit twice [empty cells are fine]
+	bool is_consistent()const;
+	// number of empty cells
+	uint count_empty()const;
+	// set the candidate masks to the digits not used by any peer
+	void compute_candidates();
+	// equality up to the symmetries given by levels [see above]; with
+	// EQ_PERMUTE_LINES this compares canonical forms [see canonical.h]
 	bool is_equal(const sudoku& s, const uint levels) const;
-	// equality comparing on level 0
+	// equality comparing on level 0 [same digits in the same cells]
 	bool operator==(const sudoku& s) const;
 	friend ostream& operator<<(ostream& os, const sudoku& s);
 	friend istream& operator>>(istream& is, sudoku& s);
 };
 
+// the cell views and storage accessors are on every hot path, keep them inline
+inline uint sudoku::get_index(const uint x, const uint y) const{
+	return y * num_digits + x;
+}
+inline sudoku_cell* sudoku::cell_at(const uint index) const{
+	// views are handed out non-const, just like the cell pointers used to be
+	return const_cast<sudoku_cell*>(&cells[index]);
+}
+inline uint sudoku::getnum_digits() const{
+	return num_digits;
+}
+inline const sudoku_geometry* sudoku::get_geometry() const{
+	return geometry;
+}
+inline uint sudoku::get_content(const uint index) const{
+	return content[index];
+}
+inline void sudoku::toggle_digit_key(const uint digit, const unsigned long long key){
+	relabel_hash -= hash_mix(digit_keys[digit]);
+	digit_keys[digit] ^= key;
+	relabel_hash += hash_mix(digit_keys[digit]);
+}
+inline void sudoku::set_content(const uint index, const uint digit){
+	const uint old = content[index];
+	if(old == digit) return;
+	hash ^= zobrist_keys[index * (num_digits + 1) + old] ^ zobrist_keys[index * (num_digits + 1) + digit];
+	if(old) toggle_digit_key(old, cell_keys[index]);
+	if(digit) toggle_digit_key(digit, cell_keys[index]);
+	content[index] = (byte)digit;
+}
+inline unsigned long long sudoku::get_hash() const{
+	return hash;
+}
+inline unsigned long long sudoku::get_relabel_hash() const{
+	return relabel_hash;
+}
+inline digit_mask sudoku::get_candidates(const uint index) const{
+	return candidates[index];
+}
+inline void sudoku::set_candidates(const uint index, const digit_mask mask){
+	candidates[index] = mask;
+}
+inline digit_mask sudoku::all_digits() const{
+	return (num_digits < MASK_DIGITS) ? (((digit_mask)1 << num_digits) - 1) : ~(digit_mask)0;
+}
+inline const byte* sudoku::get_contents() const{
+	return &content[0];
+}
+
+inline uint sudoku_cell::get_content() const{
+	return owner->get_content(index);
+}
+inline void sudoku_cell::set_content(const uint _content){
+	owner->set_content(index, _content);
+}
+inline uint sudoku_cell::get_num_digits() const{
+	return owner->getnum_digits();
+}
+inline uint sudoku_cell::get_x() const{
+	return index % owner->getnum_digits();
+}
+inline uint sudoku_cell::get_y() const{
+	return index / owner->getnum_digits();
+}
+inline uint sudoku_cell::get_index() const{
+	return index;
+}
+inline digit_mask sudoku_cell::get_candidates() const{
+	return owner->get_candidates(index);
+}
+inline void sudoku_cell::set_candidates(const digit_mask mask){
+	owner->set_candidates(index, mask);
+}
+
 
 #endif
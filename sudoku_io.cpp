@@ -0,0 +1,192 @@
+/***************************************************
+ * sudoku_io.cpp
+ * parsing and printing grids of any order
+ **************************************************/
+
+#include "sudoku_io.h"
+
+// symbol -> digit lookup, built once at startup
+class symbol_table{
+public:
+	byte value[256];
+	symbol_table(){
+		for(uint c = 0; c < 256; ++c) value[c] = NO_SYMBOL;
+		value[(byte)'0'] = 0;
+		value[(byte)'.'] = 0;
+		for(uint d = 1; d <= 9; ++d) value['0' + d] = d;
+		for(uint d = 0; d < 26; ++d){
+			value['A' + d] = 10 + d;
+			value['a' + d] = 10 + d;
+		}
+	}
+};
+static const symbol_table symbols;
+
+uint symbol_value(const unsigned char c){
+	return symbols.value[c];
+}
+
+char digit_symbol(const uint digit){
+	if(!digit) return '0';
+	if(digit <= 9) return '0' + digit;
+	if(digit <= MAX_SYMBOL_DIGITS) return 'A' + (digit - 10);
+	return '?';
+}
+
+static inline bool is_space(const char c){
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '\v') || (c == '\f');
+}
+
+// return the end of the line starting at p [the '\n' or end]
+static inline const char* line_end(const char* p, const char* end){
+	while((p != end) && (*p != '\n')) ++p;
+	return p;
+}
+
+// count the tokens of a line and return the length of the first one
+static uint count_tokens(const char* p, const char* end, uint& first_length){
+	uint tokens = 0;
+	first_length = 0;
+	while(p != end){
+		while((p != end) && is_space(*p)) ++p;
+		if(p == end) break;
+		const char* token = p;
+		while((p != end) && !is_space(*p)) ++p;
+		if(!tokens) first_length = p - token;
+		++tokens;
+	}
+	return tokens;
+}
+
+uint grid_digits(const char* begin, const char* end){
+	const char* p = begin;
+	while(p != end){
+		const char* eol = line_end(p, end);
+		uint first_length;
+		const uint tokens = count_tokens(p, eol, first_length);
+		if(tokens > 1) return tokens;
+		if(tokens == 1) return first_length;
+		p = (eol == end) ? end : eol + 1;
+	}
+	return 0;
+}
+
+bool parse_grid(const char* begin, const char* end, const uint num_digits, byte* digits, const char** next){
+	const char* p = begin;
+	bool numbers = false;
+	uint row = 0;
+	while((row < num_digits) && (p != end)){
+		const char* eol = line_end(p, end);
+		uint first_length;
+		const uint tokens = count_tokens(p, eol, first_length);
+		if(tokens){
+			if(!row) numbers = (tokens > 1);
+			byte* out = digits + row * num_digits;
+			while(is_space(*p)) ++p;
+			if(numbers){
+				if(tokens < num_digits) return false;
+				for(uint col = 0; col < num_digits; ++col){
+					uint value = 0;
+					while(is_space(*p)) ++p;
+					for(; (p != eol) && !is_space(*p); ++p)
+						value = (*p >= '0' && *p <= '9') ? value * 10 + (*p - '0') : 0;
+					out[col] = (value <= num_digits) ? value : 0;
+				}
+			} else {
+				if(first_length < num_digits) return false;
+				for(uint col = 0; col < num_digits; ++col){
+					const uint value = symbols.value[(byte)p[col]];
+					out[col] = (value <= num_digits) ? value : 0;
+				}
+			}
+			++row;
+		}
+		p = (eol == end) ? end : eol + 1;
+	}
+	if(next) *next = p;
+	return row == num_digits;
+}
+
+bool parse_line(const char* begin, const char* end, const uint num_digits, byte* digits){
+	const uint num_cells = num_digits * num_digits;
+	const char* p = begin;
+	uint first_length;
+	const uint tokens = count_tokens(begin, line_end(begin, end), first_length);
+	while((p != end) && is_space(*p)) ++p;
+	if(tokens > 1){
+		if(tokens < num_cells) return false;
+		for(uint i = 0; i < num_cells; ++i){
+			uint value = 0;
+			while(is_space(*p)) ++p;
+			for(; (p != end) && !is_space(*p); ++p)
+				value = (*p >= '0' && *p <= '9') ? value * 10 + (*p - '0') : 0;
+			digits[i] = (value <= num_digits) ? value : 0;
+		}
+	} else {
+		if(first_length < num_cells) return false;
+		for(uint i = 0; i < num_cells; ++i){
+			const uint value = symbols.value[(byte)p[i]];
+			digits[i] = (value <= num_digits) ? value : 0;
+		}
+	}
+	return true;
+}
+
+void format_grid(const byte* digits, const uint num_digits, string& out){
+	if(num_digits <= MAX_SYMBOL_DIGITS){
+		out.reserve(out.size() + num_digits * (num_digits + 1));
+		for(uint y = 0; y < num_digits; ++y){
+			for(uint x = 0; x < num_digits; ++x)
+				out += digit_symbol(digits[y * num_digits + x]);
+			out += '\n';
+		}
+	} else {
+		char number[16];
+		const int width = snprintf(number, sizeof(number), "%u", num_digits);
+		for(uint y = 0; y < num_digits; ++y){
+			for(uint x = 0; x < num_digits; ++x){
+				snprintf(number, sizeof(number), "%*u", width, digits[y * num_digits + x]);
+				if(x) out += ' ';
+				out += number;
+			}
+			out += '\n';
+		}
+	}
+}
+
+void format_line(const byte* digits, const uint num_digits, string& out){
+	const uint num_cells = num_digits * num_digits;
+	if(num_digits <= MAX_SYMBOL_DIGITS){
+		out.reserve(out.size() + num_cells + 1);
+		for(uint i = 0; i < num_cells; ++i)
+			out += digit_symbol(digits[i]);
+	} else {
+		char number[16];
+		for(uint i = 0; i < num_cells; ++i){
+			snprintf(number, sizeof(number), "%u", digits[i]);
+			if(i) out += ' ';
+			out += number;
+		}
+	}
+	out += '\n';
+}
+
+bool read_whole_file(const char* filename, string& out){
+	FILE* f;
+	const bool is_file = strcmp(filename, "stdin");
+	if(!is_file) f = stdin; else f = fopen(filename, "rb");
+	if(!f) return false;
+
+	out.clear();
+	if(is_file && !fseek(f, 0, SEEK_END)){
+		const long size = ftell(f);
+		if(size > 0) out.reserve(size);
+		fseek(f, 0, SEEK_SET);
+	}
+	char buffer[65536];
+	size_t got;
+	while((got = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		out.append(buffer, got);
+	if(is_file) fclose(f);
+	return true;
+}
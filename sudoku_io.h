@@ -0,0 +1,61 @@
+/***************************************************
+ * sudoku_io.h
+ * parsing and printing grids of any order
+ **************************************************
+ *
+ * Two text formats are understood, both one row per line:
+ *
+ *  symbols: one character per cell, digits are 1-9 followed by A-Z
+ *           [a-z is accepted as well], '0' and '.' are empty cells.
+ *           This covers grids of up to 35 digits, 9x9 rows look like
+ *           the ones in lists/.
+ *  numbers: whitespace separated decimal numbers, 0 or '.' are empty
+ *           cells. Any order can be written like this.
+ *
+ * The format is detected from the first non-empty line: a line with more
+ * than one token is a row of numbers. Blank lines between rows are
+ * skipped, so are characters behind the last cell of a symbol row.
+ * Symbols that are no digit of the grid are read as empty cells.
+ */
+
+#ifndef sudoku_io_h
+#define sudoku_io_h
+
+#include <string>
+
+#include "sudoku.h"
+
+using namespace std;
+
+// largest number of digits the symbol format can express
+#define MAX_SYMBOL_DIGITS 35
+// value of a symbol that is neither a digit nor an empty cell
+#define NO_SYMBOL 0xff
+
+// the digit a symbol stands for [0 for empty cells, NO_SYMBOL otherwise]
+uint symbol_value(const unsigned char c);
+// the symbol of a digit [0 is printed as '0']
+char digit_symbol(const uint digit);
+
+// return the number of digits of the grid starting at begin [the number of
+// cells of its first non-empty line], 0 if there is no such line
+uint grid_digits(const char* begin, const char* end);
+// parse a grid of num_digits rows starting at begin into digits [row-major,
+// num_digits * num_digits entries], return false if the input ends early or a
+// row is too short; if next is given, it receives the end of the last row
+bool parse_grid(const char* begin, const char* end, const uint num_digits, byte* digits, const char** next = NULL);
+
+// parse a grid given as a single line [all cells row after row, symbols or
+// numbers] into digits, return false if the line is too short
+bool parse_line(const char* begin, const char* end, const uint num_digits, byte* digits);
+
+// append a grid in the symbol format [or the number format if there are too
+// many digits for symbols] to out, one row per line
+void format_grid(const byte* digits, const uint num_digits, string& out);
+// append a grid as a single line [followed by a newline]
+void format_line(const byte* digits, const uint num_digits, string& out);
+
+// read a whole file [or stdin if filename is "stdin"] in one go
+bool read_whole_file(const char* filename, string& out);
+
+#endif
@@ -1,91 +1,136 @@
 #include "transform.h"
-#include <list>
+#include "geometry.h"
+#include "grid_set.h"
+#include "parallel.h"
+#include <chrono>
+#include <deque>
 
 // how big might a class of sudokus generated by transformations be?
+//
+// breadth first search from the input grid over swap_rows, swap_boxrows,
+// transpose and ambigous_rect, one level after another; grids differing
+// only by their digits count once [they are stored with normalized digits]
+//
+//   test_transform [file] [threads]
 
-bool find(list<sudoku*>* m, sudoku* s, const uint compare_param = EQ_ALL){
-	for(list<sudoku*>::const_iterator i = m->begin(); i != m->end(); i++)
-		if((*i)->is_equal(*s, compare_param)) return true;
-	return false;
-}
-
-bool sud_insert(list<sudoku*>* m, sudoku* s, const uint compare_param = EQ_ALL){
-	if(find( m, s, compare_param)) return false;
-	else {
-		m->insert(m->end(), s);
-		return true;
-	}
-}
-
-list<sudoku*> sud_class;
-list<sudoku*> sud_todo;
+// print the class if it is not bigger than this
+#define PRINT_LIMIT 100
 
-#define PRINT_ROUND 100
-int main(int argc, char** argv){
-	char* filename;
-	sudoku *su, *s;
-	long uint count = 0;
-	
-	if(argc > 1) filename=argv[1]; else filename = "stdin";
-	printf("reading file %s\n", filename);
-	su = new sudoku(filename, 1);
-	uint digits = su->getnum_digits();
-	uint order = (uint)sqrt((double)digits);
-	su->print();
+struct explorer{
+	uint num_digits;
+	uint order;
+	size_t grid_size;
+	grid_set seen;
+	deque<grid_arena> arenas;			// one per thread
+	vector<vector<const byte*> > found;	// new grids of this level, per thread
+	vector<vector<byte> > scratch;
 
-	sud_insert(&sud_todo, su);
-	while(!sud_todo.empty()){
-		count++;
-		su = sud_todo.front();
-		sud_todo.pop_front();
+	explorer(const uint _num_digits, const uint threads):num_digits(_num_digits),order(sudoku_geometry::get(_num_digits)->order),
+		grid_size(_num_digits * _num_digits),seen(grid_size),
+		found(threads),scratch(threads, vector<byte>(grid_size)){
+		for(uint t = 0; t < threads; t++)
+			arenas.emplace_back(grid_size);
+	}
 
-		// if su is not in sud_class, insert it
-		if(sud_insert(&sud_class, su)) {
+	// normalize a transformed grid and keep it if it is new
+	void offer(const byte* grid, const uint thread){
+		byte* copy = arenas[thread].alloc();
+		memcpy(copy, grid, grid_size);
+		normalize_digits(copy, num_digits);
+		if(seen.insert(copy, grid_hash(copy, grid_size)))
+			found[thread].push_back(copy);
+		else
+			arenas[thread].undo();
+	}
 
-			// do all possible transformations with s and store em in todo
-			// swap all rows
-			for(uint br = 0; br < order; br++) // boxrow
-				for(uint row1 = 0; row1 < order; row1++)
-					for(uint row2 = row1 + 1; row2 < order; row2++){
-						s = new sudoku(*su);
-						swap_rows(s, br * order + row1, br * order + row2);
-						if(!sud_insert(&sud_todo,s, EQ_NONGEOMETRIC)) delete s;
-					}
-			// swap all boxrows
-			for(uint br1 = 0; br1 < order; br1++) // boxrow1
-				for(uint br2 = br1 + 1; br2 < order; br2++){ // boxrow2
-					s = new sudoku(*su);
-					swap_boxrows(s, br1, br2);
-					if(!sud_insert(&sud_todo,s, EQ_NONGEOMETRIC)) delete s;
+	// all transformations of one grid
+	void expand(const byte* grid, const uint thread){
+		byte* s = &scratch[thread][0];
+		// swap rows inside each boxrow
+		for(uint br = 0; br < order; br++)
+			for(uint row1 = 0; row1 < order; row1++)
+				for(uint row2 = row1 + 1; row2 < order; row2++){
+					memcpy(s, grid, grid_size);
+					swap_rows(s, num_digits, br * order + row1, br * order + row2);
+					offer(s, thread);
+				}
+		// swap boxrows
+		for(uint br1 = 0; br1 < order; br1++)
+			for(uint br2 = br1 + 1; br2 < order; br2++){
+				memcpy(s, grid, grid_size);
+				swap_boxrows(s, num_digits, order, br1, br2);
+				offer(s, thread);
+			}
+		// transpose
+		memcpy(s, grid, grid_size);
+		transpose(s, num_digits);
+		offer(s, thread);
+		// ambigous rects [the test of is_ambigous_rect(), with the corners read once]
+		for(uint y0 = 0; y0 < num_digits; y0++)
+			for(uint y1 = y0 + 1; y1 < num_digits; y1++){
+				const byte* row0 = grid + y0 * num_digits;
+				const byte* row1 = grid + y1 * num_digits;
+				const bool same_band = (y0 / order == y1 / order);
+				for(uint x0 = 0; x0 < num_digits; x0++){
+					if(!row0[x0] || !row1[x0]) continue;
+					for(uint x1 = x0 + 1; x1 < num_digits; x1++)
+						if((row0[x0] == row1[x1]) && (row1[x0] == row0[x1]) && (same_band || (x0 / order == x1 / order))){
+							memcpy(s, grid, grid_size);
+							ambigous_rect(s, num_digits, order, x0, y0, x1, y1);
+							offer(s, thread);
+						}
 				}
-			// transpose
-			s = new sudoku(*su);
-			transpose(s);
-			if(!sud_insert(&sud_todo,s, EQ_NONGEOMETRIC)) delete s;
-
-			// posspace transformation
-			s = new sudoku(*su);
-			posspace_transform(s);
-			if(!sud_insert(&sud_todo,s, EQ_NONGEOMETRIC)) delete s;
-
-			// ambigous rect
-			uint x0,y0,x1,y1;
-			x0=y0=x1=y1=0;
-			while(find_next_ambigous_rect(su, x0, y0, x1, y1)){
-				s = new sudoku(*su);
-				ambigous_rect(s, x0, y0, x1, y1);
-				if(!sud_insert(&sud_todo,s, EQ_NONGEOMETRIC)) delete s;
 			}
+	}
 
-		} else delete su;
-		if(!(count % PRINT_ROUND)) printf("round %ld:\t%d sudokus in the class\n", count, sud_class.size());
-		if(!(count % PRINT_ROUND)) printf("round %ld:\t%d sudokus in todo list\n", count, sud_todo.size());
+	size_t memory(){
+		size_t result = seen.memory();
+		for(uint t = 0; t < arenas.size(); t++)
+			result += arenas[t].memory();
+		return result;
 	}
-	printf("final round %ld:\t%d sudokus in todo list\n", count, sud_todo.size());
-	printf("%d sudokus in the class\n",  sud_class.size());
-	for(list<sudoku*>::iterator i = sud_class.begin(); i != sud_class.end(); i++){
-		(*i)->print();
-		printf("====\n");
+};
+
+int main(int argc, char** argv){
+	const char* filename = (argc > 1) ? argv[1] : "stdin";
+	const uint threads = (argc > 2) ? atoi(argv[2]) : default_threads();
+	printf("reading file %s\n", filename);
+	sudoku su(filename);
+	su.print();
+
+	const uint digits = su.getnum_digits();
+	explorer ex(digits, threads ? threads : 1);
+	ex.offer(su.get_contents(), 0);
+	vector<const byte*> level(ex.found[0]);
+	vector<const byte*> all(level);		// the whole class, in order of discovery
+	ex.found[0].clear();
+
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	uint depth = 0;
+	while(!level.empty()){
+		parallel_for(level.size(), ex.arenas.size(), [&](const size_t begin, const size_t end, const uint thread){
+			for(size_t i = begin; i < end; i++)
+				ex.expand(level[i], thread);
+		});
+		level.clear();
+		for(uint t = 0; t < ex.found.size(); t++){
+			level.insert(level.end(), ex.found[t].begin(), ex.found[t].end());
+			ex.found[t].clear();
+		}
+		if(all.size() <= PRINT_LIMIT) all.insert(all.end(), level.begin(), level.end());
+		depth++;
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		printf("level %u:\t%zu sudokus in the class, %zu new, %.1f MB, %.2fs, %.0f sudokus/s\n", depth,
+			ex.seen.size(), level.size(), ex.memory() / 1048576.0, seconds, ex.seen.size() / (seconds > 0 ? seconds : 1));
 	}
+	printf("%zu sudokus in the class\n", ex.seen.size());
 
+	if(all.size() <= PRINT_LIMIT){
+		sudoku out(digits);
+		for(size_t i = 0; i < all.size(); i++){
+			out.set_contents(all[i]);
+			out.print();
+			printf("====\n");
+		}
+	}
 }
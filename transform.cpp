@@ -9,6 +9,7 @@
 #define transform_cpp
 
 #include "transform.h"
+#include <algorithm>
 
 // rotates coordinates (x,y) 90 degrees with rotation center (center2_x / 2, center2_y / 2)
 void rotate90(int& x, int& y, const int center2_x, const int center2_y, const unsigned char times){
@@ -59,9 +60,7 @@ void swap_rows(sudoku* s, const uint row1, const uint row2){
 
 void swap_boxrows(sudoku* s, const uint boxrow1, const uint boxrow2){
 	if(!s) return;
-	uint digits = s->getnum_digits();
-	uint order = (uint)sqrt((double)digits);
-	if(order * order != digits) return;
+	uint order = s->get_order();
 	if((boxrow1 >= order) || (boxrow2 >= order) || (boxrow1 == boxrow2)) return;
 
 	for(uint i = 0; i < order; i++)
@@ -87,8 +86,7 @@ void permute_digits(sudoku* s, const uint* new_digits){
 
 void intswap(uint& x1, uint& x2){ uint tmp=x1;x1=x2;x2=tmp;}
 bool is_ambigous_rect(sudoku* s, uint x0, uint y0, uint x1, uint y1){
-	uint digits = s->getnum_digits();
-	uint order = (uint)sqrt((double)digits);
+	uint order = s->get_order();
 	if((x0 == x1) || (y0 == y1)) return false;
 	if(x0 > x1) intswap(x0,x1);
 	if(y0 > y1) intswap(y0,y1);
@@ -131,5 +129,54 @@ void ambigous_rect(sudoku* s, uint x0, uint y0, uint x1, uint y1){
 	s->get_cell(x1,y1)->set_content(cont01);
 }
 
+
+// flat grids
+void swap_rows(byte* grid, const uint num_digits, const uint row1, const uint row2){
+	if((row1 >= num_digits) || (row2 >= num_digits) || (row1 == row2)) return;
+	swap_ranges(grid + row1 * num_digits, grid + (row1 + 1) * num_digits, grid + row2 * num_digits);
+}
+
+void swap_boxrows(byte* grid, const uint num_digits, const uint order, const uint boxrow1, const uint boxrow2){
+	if((boxrow1 >= order) || (boxrow2 >= order) || (boxrow1 == boxrow2)) return;
+	swap_ranges(grid + boxrow1 * order * num_digits, grid + (boxrow1 + 1) * order * num_digits, grid + boxrow2 * order * num_digits);
+}
+
+void transpose(byte* grid, const uint num_digits){
+	for(uint x = 0; x < num_digits; x++)
+		for(uint y = x + 1; y < num_digits; y++)
+			swap(grid[y * num_digits + x], grid[x * num_digits + y]);
+}
+
+bool is_ambigous_rect(const byte* grid, const uint num_digits, const uint order, uint x0, uint y0, uint x1, uint y1){
+	if((x0 == x1) || (y0 == y1)) return false;
+	if(x0 > x1) intswap(x0,x1);
+	if(y0 > y1) intswap(y0,y1);
+
+	// the rect must intersect no more then 2 boxes
+	if((x0 / order != x1 / order) && (y0 / order != y1 / order)) return false;
+	// the digits across must be equal and nonzero
+	const uint cont00 = grid[y0 * num_digits + x0];
+	const uint cont01 = grid[y1 * num_digits + x0];
+	return cont00 && cont01 && (cont00 == grid[y1 * num_digits + x1]) && (cont01 == grid[y0 * num_digits + x1]);
+}
+
+void ambigous_rect(byte* grid, const uint num_digits, const uint order, uint x0, uint y0, uint x1, uint y1){
+	if(!is_ambigous_rect(grid, num_digits, order, x0, y0, x1, y1)) return;
+	// exchanging the digits of each row of the rect
+	swap(grid[y0 * num_digits + x0], grid[y0 * num_digits + x1]);
+	swap(grid[y1 * num_digits + x0], grid[y1 * num_digits + x1]);
+}
+
+void normalize_digits(byte* grid, const uint num_digits){
+	byte label[MASK_DIGITS + 1] = {0};
+	byte next = 1;
+	for(uint i = 0; i < num_digits * num_digits; i++){
+		const byte d = grid[i];
+		if(!d) continue;
+		if(!label[d]) label[d] = next++;
+		grid[i] = label[d];
+	}
+}
+
 #endif
 
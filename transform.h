@@ -38,5 +38,15 @@ void transpose(sudoku* s);
 void permute_digits(sudoku* s, const uint* new_digits);
 bool find_next_ambigous_rect(sudoku* s, uint& _x0, uint& _y0, uint& _x1, uint& _y1);
 void ambigous_rect(sudoku* s, uint x0, uint y0, uint x1, uint y1);
+
+// the same on flat grids [row-major, num_digits * num_digits bytes; order is
+// the side of a box, see sudoku_geometry]
+void swap_rows(byte* grid, const uint num_digits, const uint row1, const uint row2);
+void swap_boxrows(byte* grid, const uint num_digits, const uint order, const uint boxrow1, const uint boxrow2);
+void transpose(byte* grid, const uint num_digits);
+bool is_ambigous_rect(const byte* grid, const uint num_digits, const uint order, uint x0, uint y0, uint x1, uint y1);
+void ambigous_rect(byte* grid, const uint num_digits, const uint order, uint x0, uint y0, uint x1, uint y1);
+// relabel the digits 1, 2, ... in order of first appearance [row-major]
+void normalize_digits(byte* grid, const uint num_digits);
 #endif
 
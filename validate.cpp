@@ -0,0 +1,31 @@
+/***************************************************
+ * validate.cpp
+ * checking single grids and batches of grids
+ **************************************************/
+
+#include "validate.h"
+#include "grid_core.h"
+
+uint failing_units(const sudoku& s, const bool complete, vector<uint>* units){
+	const grid_kernels* kernels = grid_kernels::get(s.getnum_digits());
+	const uint num_units = 3 * s.getnum_digits();
+	vector<uint64_t> failed((num_units + 63) / 64);
+	const uint result = kernels->failing_units(s.get_contents(), complete, &failed[0]);
+	if(units)
+		for(uint unit = 0; unit < num_units; ++unit)
+			if(failed[unit / 64] & ((uint64_t)1 << (unit % 64))) units->push_back(unit);
+	return result;
+}
+
+string unit_name(const uint unit, const uint num_digits){
+	static const char* const names[3] = {"row ", "column ", "box "};
+	return names[(unit / num_digits) % 3] + to_string(unit % num_digits);
+}
+
+size_t check_batch(const byte* grids, const size_t count, const uint num_digits, const bool complete, byte* ok){
+	grid_kernels::get(num_digits)->check_batch(grids, count, complete, ok);
+	size_t result = 0;
+	for(size_t i = 0; i < count; ++i)
+		result += ok[i];
+	return result;
+}
@@ -0,0 +1,34 @@
+/***************************************************
+ * validate.h
+ * checking single grids and batches of grids
+ **************************************************
+ *
+ * A grid is consistent if no row, column or box contains a digit twice,
+ * and valid if it is consistent and complete. Both checks are done by
+ * the grid kernels [see grid_core.h] on the flat content of the grids:
+ * failing_units() tells which units of a single grid fail, check_batch()
+ * validates a whole batch of grids side by side in vector registers.
+ */
+
+#ifndef validate_h
+#define validate_h
+
+#include <string>
+#include <vector>
+
+#include "sudoku.h"
+
+using namespace std;
+
+// the units [numbered like in geometry.h] of s that contain a digit twice or,
+// if complete, miss a digit; return their number
+uint failing_units(const sudoku& s, const bool complete, vector<uint>* units = NULL);
+// "row 3", "column 1" or "box 7" [counting from 0]
+string unit_name(const uint unit, const uint num_digits);
+
+// check count grids of num_digits digits stored one after another in grids
+// [num_digits * num_digits bytes each]; ok[i] is set iff grid i passes,
+// return the number of grids passing
+size_t check_batch(const byte* grids, const size_t count, const uint num_digits, const bool complete, byte* ok);
+
+#endif